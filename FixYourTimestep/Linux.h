@@ -0,0 +1,141 @@
+// Simple Linux OpenGL framework
+
+#ifdef __linux__
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glx.h>
+
+#include <string.h>
+#include <time.h>
+
+Display *display = 0;
+Window window = 0;
+GLXContext context = 0;
+Atom closeMessage = 0;
+
+bool openDisplay(const char title[], int width, int height)
+{
+    display = XOpenDisplay(0);
+    if (!display)
+        return false;
+
+    // choose visual
+
+    int attributes[] = { GLX_RGBA, GLX_DOUBLEBUFFER, GLX_DEPTH_SIZE, 16, None };
+
+    XVisualInfo *visual = glXChooseVisual(display, DefaultScreen(display), attributes);
+    if (!visual)
+        return false;
+
+    // create window
+
+    Window root = RootWindow(display, visual->screen);
+
+    XSetWindowAttributes windowAttributes;
+    memset(&windowAttributes, 0, sizeof(windowAttributes));
+    windowAttributes.colormap = XCreateColormap(display, root, visual->visual, AllocNone);
+    windowAttributes.event_mask = KeyPressMask | StructureNotifyMask;
+
+    const int x = (DisplayWidth(display, visual->screen) - width) >> 1;
+    const int y = (DisplayHeight(display, visual->screen) - height) >> 1;
+
+    window = XCreateWindow( display, root, x, y, width, height, 0,
+                            visual->depth, InputOutput, visual->visual,
+                            CWColormap | CWEventMask, &windowAttributes );
+
+    if (!window)
+    {
+        XFree(visual);
+        return false;
+    }
+
+    XStoreName(display, window, title);
+
+    // window is not resizable
+
+    XSizeHints hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.flags = PMinSize | PMaxSize;
+    hints.min_width = hints.max_width = width;
+    hints.min_height = hints.max_height = height;
+    XSetWMNormalHints(display, window, &hints);
+
+    // ask to be notified when the window is closed
+
+    closeMessage = XInternAtom(display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(display, window, &closeMessage, 1);
+
+    // initialize glx
+
+    context = glXCreateContext(display, visual, 0, True);
+
+    XFree(visual);
+
+    if (!context)
+        return false;
+
+    if (!glXMakeCurrent(display, window, context))
+        return false;
+
+    // show window
+
+    XMapRaised(display, window);
+
+    return true;
+}
+
+void updateDisplay()
+{
+    // process pending events
+
+    while (XPending(display))
+    {
+        XEvent event;
+        XNextEvent(display, &event);
+
+        switch (event.type)
+        {
+            case KeyPress:
+                if (XLookupKeysym(&event.xkey, 0)==XK_Escape)
+                    onQuit();
+                break;
+
+            case ClientMessage:
+                if ((Atom)event.xclient.data.l[0]==closeMessage)
+                    onQuit();
+                break;
+        }
+    }
+
+    // show rendering
+
+    glXSwapBuffers(display, window);
+}
+
+void closeDisplay()
+{
+    glXMakeCurrent(display, None, 0);
+    glXDestroyContext(display, context);
+    context = 0;
+
+    XDestroyWindow(display, window);
+    window = 0;
+
+    XCloseDisplay(display);
+    display = 0;
+}
+
+unsigned long long nanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#endif
@@ -2,14 +2,19 @@
 // Copyright (c) Glenn Fiedler 2004
 // http://www.gaffer.org/articles
 
-bool openDisplay(int width, int height);
+bool openDisplay(const char title[], int width, int height);
 void updateDisplay();
 void closeDisplay();
 void onQuit();
-float time();
+unsigned long long nanoseconds();
 
 #include "Apple.h"
 #include "Windows.h"
+#include "Linux.h"
+
+//#define THREADED_SIMULATION
+
+#include "Scheduler.h"
 
 bool quit = false;
 
@@ -78,6 +83,28 @@ void integrate(State &state, float t, float dt)
 	state.v = state.v + dvdt*dt;
 }
 
+/// Spring simulation stepped by the scheduler.
+/// Steps its own copy of the state and publishes the previous and current
+/// states for rendering.
+
+struct Spring : public Scheduler::Simulation
+{
+	State state;
+	State previous;
+	State current;
+
+	void step(unsigned int tick, float dt)
+	{
+		integrate(state, tick*dt, dt);
+	}
+
+	void publish()
+	{
+		previous = current;
+		current = state;
+	}
+};
+
 int main()
 {
 	const int width = 640;
@@ -100,41 +127,32 @@ int main()
 	
 	glClearColor(0.3f, 0.3f, 0.3f, 1);
 
-	State current;
-	current.x = 100;
-	current.v = 0;
-	
-	State previous = current;
+	Spring spring;
+	spring.state.x = 100;
+	spring.state.v = 0;
+	spring.previous = spring.current = spring.state;
 
-	float t = 0.0f;
-	float dt = 0.1f;
-	
-	float currentTime = 0.0f;
-	float accumulator = 0.0f;
+	Scheduler scheduler(0.1f);
+
+#ifdef THREADED_SIMULATION
+	scheduler.start(spring);
+#endif
 	
 	while (!quit) 
 	{			
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		
-		const float newTime = time();
-		float deltaTime = newTime - currentTime;
-		currentTime = newTime;
-		
-		if (deltaTime>0.25f)
-			deltaTime = 0.25f;
-		
-		accumulator += deltaTime;
+		if (!scheduler.threaded())
+			scheduler.update(spring);
 		
-		while (accumulator>=dt)
+		State state;
 		{
-			accumulator -= dt;
-			previous = current;
-			integrate(current, t, dt);
-			t += dt;
+#ifdef THREADED_SIMULATION
+			Scheduler::Lock lock(scheduler);
+#endif
+			state = interpolate(spring.previous, spring.current, scheduler.alpha());
 		}
 		
-		State state = interpolate(previous, current, accumulator/dt);
-		
 		glBegin(GL_POINTS);
 		glColor3f(1,1,1);
 		glVertex3f(state.x, 0, 0);
@@ -143,6 +161,10 @@ int main()
 		updateDisplay();
 	}
 	
+#ifdef THREADED_SIMULATION
+	scheduler.stop();
+#endif
+
 	closeDisplay();
 	
 	return 0;
@@ -0,0 +1,163 @@
+// Batched RK4 integration of many spring states
+// Copyright (c) 2004, Glenn Fiedler
+// http://www.gaffer.org/articles
+//
+// Integrates arrays of {x,v} spring states stored as separate x and v arrays.
+// The spring and damping constants are passed in, pass the stiffness and
+// damping constants from Integration.h to match acceleration() there.
+// Four states are integrated at once with SSE when available, and blocks of
+// states are spread across threads when compiled with OpenMP. The arithmetic
+// is performed in the same order as integrate() in Integration.h so results
+// match the scalar integrator.
+
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP>=1)
+#define BATCH_SSE
+#include <xmmintrin.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace Batch
+{
+	const int blockSize = 16384;        ///< number of states per block handed to each thread.
+
+	/// Integrate states [begin,end) with one scalar RK4 step each.
+
+	inline void integrateScalar(float x[], float v[], int begin, int end, float k, float b, float dt)
+	{
+		const float h = dt*0.5f;
+
+		for (int i=begin; i<end; i++)
+		{
+			const float adx = v[i];
+			const float adv = - k*x[i] - b*v[i];
+
+			const float bx = x[i] + adx*h;
+			const float bv = v[i] + adv*h;
+			const float bdx = bv;
+			const float bdv = - k*bx - b*bv;
+
+			const float cx = x[i] + bdx*h;
+			const float cv = v[i] + bdv*h;
+			const float cdx = cv;
+			const float cdv = - k*cx - b*cv;
+
+			const float dx = x[i] + cdx*dt;
+			const float dv = v[i] + cdv*dt;
+			const float ddx = dv;
+			const float ddv = - k*dx - b*dv;
+
+			const float dxdt = 1.0f/6.0f * (adx + 2.0f*(bdx + cdx) + ddx);
+			const float dvdt = 1.0f/6.0f * (adv + 2.0f*(bdv + cdv) + ddv);
+
+			x[i] = x[i] + dxdt*dt;
+			v[i] = v[i] + dvdt*dt;
+		}
+	}
+
+#ifdef BATCH_SSE
+
+	/// Calculate spring acceleration for four states: - k*x - b*v
+
+	inline __m128 acceleration(__m128 x, __m128 v, __m128 k, __m128 b, __m128 sign)
+	{
+		return _mm_sub_ps(_mm_xor_ps(_mm_mul_ps(k, x), sign), _mm_mul_ps(b, v));
+	}
+
+	/// Integrate states [begin,end) four at a time with SSE.
+	/// Any remainder that does not fill four lanes is integrated with the scalar path.
+
+	inline void integrateRange(float x[], float v[], int begin, int end, float k, float b, float dt)
+	{
+		const __m128 K = _mm_set1_ps(k);
+		const __m128 B = _mm_set1_ps(b);
+		const __m128 sign = _mm_set1_ps(-0.0f);
+		const __m128 h = _mm_set1_ps(dt*0.5f);
+		const __m128 full = _mm_set1_ps(dt);
+		const __m128 two = _mm_set1_ps(2.0f);
+		const __m128 sixth = _mm_set1_ps(1.0f/6.0f);
+
+		int i = begin;
+
+		for (; i+4<=end; i+=4)
+		{
+			const __m128 x0 = _mm_loadu_ps(x+i);
+			const __m128 v0 = _mm_loadu_ps(v+i);
+
+			const __m128 adx = v0;
+			const __m128 adv = acceleration(x0, v0, K, B, sign);
+
+			const __m128 bx = _mm_add_ps(x0, _mm_mul_ps(adx, h));
+			const __m128 bv = _mm_add_ps(v0, _mm_mul_ps(adv, h));
+			const __m128 bdx = bv;
+			const __m128 bdv = acceleration(bx, bv, K, B, sign);
+
+			const __m128 cx = _mm_add_ps(x0, _mm_mul_ps(bdx, h));
+			const __m128 cv = _mm_add_ps(v0, _mm_mul_ps(bdv, h));
+			const __m128 cdx = cv;
+			const __m128 cdv = acceleration(cx, cv, K, B, sign);
+
+			const __m128 dx = _mm_add_ps(x0, _mm_mul_ps(cdx, full));
+			const __m128 dv = _mm_add_ps(v0, _mm_mul_ps(cdv, full));
+			const __m128 ddx = dv;
+			const __m128 ddv = acceleration(dx, dv, K, B, sign);
+
+			const __m128 dxdt = _mm_mul_ps(sixth, _mm_add_ps(_mm_add_ps(adx, _mm_mul_ps(two, _mm_add_ps(bdx, cdx))), ddx));
+			const __m128 dvdt = _mm_mul_ps(sixth, _mm_add_ps(_mm_add_ps(adv, _mm_mul_ps(two, _mm_add_ps(bdv, cdv))), ddv));
+
+			_mm_storeu_ps(x+i, _mm_add_ps(x0, _mm_mul_ps(dxdt, full)));
+			_mm_storeu_ps(v+i, _mm_add_ps(v0, _mm_mul_ps(dvdt, full)));
+		}
+
+		integrateScalar(x, v, i, end, k, b, dt);
+	}
+
+#else
+
+	inline void integrateRange(float x[], float v[], int begin, int end, float k, float b, float dt)
+	{
+		integrateScalar(x, v, begin, end, k, b, dt);
+	}
+
+#endif
+
+	/// Integrate count spring states forward by dt seconds.
+	/// @param x array of positions.
+	/// @param v array of velocities.
+	/// @param count number of states in each array.
+	/// @param k spring constant.
+	/// @param b damping constant.
+	/// @param dt timestep in seconds.
+	/// @param threads number of threads to use, zero uses all available threads. ignored without OpenMP.
+
+	inline void integrate(float x[], float v[], int count, float k, float b, float dt, int threads = 0)
+	{
+		if (count<=0)
+			return;
+
+#ifdef _OPENMP
+		if (threads!=1 && count>blockSize)
+		{
+			const int blocks = (count + blockSize - 1) / blockSize;
+
+			if (threads<=0)
+				threads = omp_get_max_threads();
+
+			#pragma omp parallel for num_threads(threads) schedule(static)
+			for (int block=0; block<blocks; block++)
+			{
+				const int begin = block * blockSize;
+				const int end = begin + blockSize < count ? begin + blockSize : count;
+				integrateRange(x, v, begin, end, k, b, dt);
+			}
+
+			return;
+		}
+#else
+		(void) threads;
+#endif
+		integrateRange(x, v, 0, count, k, b, dt);
+	}
+}
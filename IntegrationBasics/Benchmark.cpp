@@ -0,0 +1,629 @@
+// Integrator accuracy and cost benchmark
+// Copyright (c) 2004, Glenn Fiedler
+// http://www.gaffer.org/articles
+//
+// Runs the damped spring from Integration.h and the cube force model from
+// PhysicsIn3D with each integrator across a sweep of timesteps, reporting
+// error against a reference solution, energy drift and the cost per step.
+//
+// It also measures the batched spring integrator in Batch.h against the
+// scalar integrate() and reports states integrated per second.
+//
+// usage: Benchmark [error budget] [batch states]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+#include "Integration.h"
+#include "Batch.h"
+
+#include "../PhysicsIn3D/Mathematics.h"
+#include "../PhysicsIn3D/Vector.h"
+#include "../PhysicsIn3D/Matrix.h"
+#include "../PhysicsIn3D/Quaternion.h"
+
+/// High resolution timer in seconds.
+
+double seconds()
+{
+#ifdef _WIN32
+	static __int64 frequency = 0;
+	if (frequency==0)
+		QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
+	__int64 counter = 0;
+	QueryPerformanceCounter((LARGE_INTEGER*)&counter);
+	return counter / double(frequency);
+#else
+	timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec * 0.000000001;
+#endif
+}
+
+/// Damped spring model from Integration.h.
+/// The analytic solution of the underdamped spring is used as the reference.
+
+struct Spring
+{
+	typedef ::State State;
+	typedef ::Derivative Derivative;
+
+	static const char* name() { return "spring"; }
+
+	static State initial()
+	{
+		State state;
+		state.x = 100;
+		state.v = 0;
+		return state;
+	}
+
+	static Derivative evaluate(const State &state, float t)
+	{
+		return ::evaluate(state, t);
+	}
+
+	static State advance(State state, float dt, const Derivative &derivative)
+	{
+		state.x += derivative.dx * dt;
+		state.v += derivative.dv * dt;
+		return state;
+	}
+
+	static void accelerate(State &state, float dt, const Derivative &derivative)
+	{
+		state.v += derivative.dv * dt;
+	}
+
+	static void drift(State &state, float dt)
+	{
+		state.x += state.v * dt;
+	}
+
+	static double energy(const State &state)
+	{
+		const double k = stiffness;
+		return 0.5 * state.v * state.v + 0.5 * k * state.x * state.x;
+	}
+
+	static double error(const State &a, const State &b)
+	{
+		return fabs(a.x - b.x);
+	}
+
+	static State solution(double t)
+	{
+		const double k = stiffness;
+		const double b = damping;
+		const double x0 = 100;
+		const double v0 = 0;
+
+		const double gamma = b * 0.5;
+		const double omega = ::sqrt(k - gamma*gamma);
+		const double A = x0;
+		const double B = (v0 + gamma*x0) / omega;
+
+		const double decay = exp(-gamma*t);
+		const double c = cos(omega*t);
+		const double s = ::sin(omega*t);
+
+		State state;
+		state.x = (float) (decay * (A*c + B*s));
+		state.v = (float) (decay * ((B*omega - gamma*A)*c - (A*omega + gamma*B)*s));
+		return state;
+	}
+};
+
+inline Derivative operator+(const Derivative &a, const Derivative &b)
+{
+	Derivative output;
+	output.dx = a.dx + b.dx;
+	output.dv = a.dv + b.dv;
+	return output;
+}
+
+inline Derivative operator*(const Derivative &a, float s)
+{
+	Derivative output;
+	output.dx = a.dx * s;
+	output.dv = a.dv * s;
+	return output;
+}
+
+/// Cube rigid body with the same state and force model as Cube in PhysicsIn3D.
+/// There is no analytic solution so a fine RK4 integration is used as reference.
+
+struct CubeModel
+{
+	struct State
+	{
+		Mathematics::Vector position;
+		Mathematics::Vector momentum;
+		Mathematics::Quaternion orientation;
+		Mathematics::Vector angularMomentum;
+
+		Mathematics::Vector velocity;
+		Mathematics::Quaternion spin;
+		Mathematics::Vector angularVelocity;
+		Mathematics::Matrix bodyToWorld;
+		Mathematics::Matrix worldToBody;
+
+		float size;
+		float mass;
+		float inverseMass;
+		float inertiaTensor;
+		float inverseInertiaTensor;
+
+		void recalculate()
+		{
+			velocity = momentum * inverseMass;
+			angularVelocity = angularMomentum * inverseInertiaTensor;
+			orientation.normalize();
+			spin = 0.5 * Mathematics::Quaternion(0, angularVelocity.x, angularVelocity.y, angularVelocity.z) * orientation;
+			Mathematics::Matrix translation;
+			translation.translate(position);
+			bodyToWorld = translation * orientation.matrix();
+			worldToBody = bodyToWorld.inverse();
+		}
+	};
+
+	struct Derivative
+	{
+		Mathematics::Vector velocity;
+		Mathematics::Vector force;
+		Mathematics::Quaternion spin;
+		Mathematics::Vector torque;
+
+		Derivative operator+(const Derivative &other) const
+		{
+			Derivative output;
+			output.velocity = velocity + other.velocity;
+			output.force = force + other.force;
+			output.spin = spin + other.spin;
+			output.torque = torque + other.torque;
+			return output;
+		}
+
+		Derivative operator*(float s) const
+		{
+			Derivative output;
+			output.velocity = velocity * s;
+			output.force = force * s;
+			output.spin = spin * s;
+			output.torque = torque * s;
+			return output;
+		}
+	};
+
+	static const char* name() { return "cube"; }
+
+	static State initial()
+	{
+		State state;
+		state.size = 1;
+		state.mass = 1;
+		state.inverseMass = 1.0f / state.mass;
+		state.position = Mathematics::Vector(2,0,0);
+		state.momentum = Mathematics::Vector(0,0,-10);
+		state.orientation.identity();
+		state.angularMomentum = Mathematics::Vector(0,0,0);
+		state.inertiaTensor = state.mass * state.size * state.size * 1.0f / 6.0f;
+		state.inverseInertiaTensor = 1.0f / state.inertiaTensor;
+		state.recalculate();
+		return state;
+	}
+
+	static Derivative evaluate(const State &state, float t)
+	{
+		Derivative output;
+		output.velocity = state.velocity;
+		output.spin = state.spin;
+		forces(state, t, output.force, output.torque);
+		return output;
+	}
+
+	static State advance(State state, float dt, const Derivative &derivative)
+	{
+		state.position += derivative.velocity * dt;
+		state.momentum += derivative.force * dt;
+		state.orientation += derivative.spin * dt;
+		state.angularMomentum += derivative.torque * dt;
+		state.recalculate();
+		return state;
+	}
+
+	static void accelerate(State &state, float dt, const Derivative &derivative)
+	{
+		state.momentum += derivative.force * dt;
+		state.angularMomentum += derivative.torque * dt;
+		state.recalculate();
+	}
+
+	static void drift(State &state, float dt)
+	{
+		state.position += state.velocity * dt;
+		state.orientation += state.spin * dt;
+		state.recalculate();
+	}
+
+	/// kinetic energy plus potential energy of the spring attracting the cube to the origin.
+
+	static double energy(const State &state)
+	{
+		const double k = stiffness;
+		return 0.5 * state.momentum.lengthSquared() * state.inverseMass +
+			   0.5 * state.angularMomentum.lengthSquared() * state.inverseInertiaTensor +
+			   0.5 * k * state.position.lengthSquared();
+	}
+
+	static double error(const State &a, const State &b)
+	{
+		return (a.position - b.position).length();
+	}
+
+	/// see Cube::forces in PhysicsIn3D/Cube.h, the spring uses the stiffness from Integration.h.
+
+	static void forces(const State &state, float t, Mathematics::Vector &force, Mathematics::Vector &torque)
+	{
+		force = -stiffness * state.position;
+
+		force.x += 10 * Mathematics::sin(t*0.9f + 0.5f);
+		force.y += 11 * Mathematics::sin(t*0.5f + 0.4f);
+		force.z += 12 * Mathematics::sin(t*0.7f + 0.9f);
+
+		torque.x = 1.0f * Mathematics::sin(t*0.9f + 0.5f);
+		torque.y = 1.1f * Mathematics::sin(t*0.5f + 0.4f);
+		torque.z = 1.2f * Mathematics::sin(t*0.7f + 0.9f);
+
+		torque -= 0.2f * state.angularVelocity;
+	}
+};
+
+/// Explicit euler integration.
+
+template <typename Model> void euler(typename Model::State &state, float t, float dt)
+{
+	state = Model::advance(state, dt, Model::evaluate(state, t));
+}
+
+/// Semi-implicit euler integration.
+/// Velocity is updated first then used to update position.
+
+template <typename Model> void semiImplicitEuler(typename Model::State &state, float t, float dt)
+{
+	Model::accelerate(state, dt, Model::evaluate(state, t));
+	Model::drift(state, dt);
+}
+
+/// Classic fourth order runge kutta integration.
+
+template <typename Model> void rk4(typename Model::State &state, float t, float dt)
+{
+	typedef typename Model::Derivative Derivative;
+
+	const Derivative a = Model::evaluate(state, t);
+	const Derivative b = Model::evaluate(Model::advance(state, dt*0.5f, a), t + dt*0.5f);
+	const Derivative c = Model::evaluate(Model::advance(state, dt*0.5f, b), t + dt*0.5f);
+	const Derivative d = Model::evaluate(Model::advance(state, dt, c), t + dt);
+
+	state = Model::advance(state, dt, (a + (b + c)*2.0f + d) * (1.0f/6.0f));
+}
+
+/// Fifth order dormand-prince integration with a fixed step.
+/// This is the integrator behind the adaptive Cube::integrateAdaptive in
+/// Zen of Networked Physics, without the embedded error estimate.
+
+template <typename Model> void dormandPrince(typename Model::State &state, float t, float dt)
+{
+	typedef typename Model::Derivative Derivative;
+
+	const Derivative k1 = Model::evaluate(state, t);
+	const Derivative k2 = Model::evaluate(Model::advance(state, dt, k1*(1.0f/5.0f)), t + dt*(1.0f/5.0f));
+	const Derivative k3 = Model::evaluate(Model::advance(state, dt, k1*(3.0f/40.0f) + k2*(9.0f/40.0f)), t + dt*(3.0f/10.0f));
+	const Derivative k4 = Model::evaluate(Model::advance(state, dt, k1*(44.0f/45.0f) + k2*(-56.0f/15.0f) + k3*(32.0f/9.0f)), t + dt*(4.0f/5.0f));
+	const Derivative k5 = Model::evaluate(Model::advance(state, dt, k1*(19372.0f/6561.0f) + k2*(-25360.0f/2187.0f) + k3*(64448.0f/6561.0f) + k4*(-212.0f/729.0f)), t + dt*(8.0f/9.0f));
+	const Derivative k6 = Model::evaluate(Model::advance(state, dt, k1*(9017.0f/3168.0f) + k2*(-355.0f/33.0f) + k3*(46732.0f/5247.0f) + k4*(49.0f/176.0f) + k5*(-5103.0f/18656.0f)), t + dt);
+
+	state = Model::advance(state, dt, k1*(35.0f/384.0f) + k3*(500.0f/1113.0f) + k4*(125.0f/192.0f) + k5*(-2187.0f/6784.0f) + k6*(11.0f/84.0f));
+}
+
+/// Results for one integrator at one timestep.
+
+struct Result
+{
+	const char *system;
+	const char *integrator;
+	float dt;
+	double error;               ///< maximum error against the reference over the run.
+	double drift;               ///< final energy relative to reference energy, as a fraction of initial energy.
+	double nanoseconds;         ///< average cost of one step in nanoseconds.
+	double cost;                ///< cost to simulate one second in microseconds.
+};
+
+const float duration = 10.0f;                 ///< simulated seconds per run.
+const float referenceStep = 0.001f;           ///< interval between reference samples.
+const int referenceSubsteps = 100;            ///< rk4 substeps per reference sample for systems without analytic solution.
+const int timingRuns = 5;                     ///< number of timed runs, the fastest one is reported.
+
+volatile double sink = 0;                     ///< receives results of timed runs so they are not optimized away.
+
+/// Build the reference trajectory sampled every referenceStep seconds.
+
+void reference(std::vector<Spring::State> &samples)
+{
+	const int count = (int) (duration / referenceStep + 0.5f) + 1;
+	samples.resize(count);
+	for (int i=0; i<count; i++)
+		samples[i] = Spring::solution(i * (double)referenceStep);
+}
+
+void reference(std::vector<CubeModel::State> &samples)
+{
+	const int count = (int) (duration / referenceStep + 0.5f) + 1;
+	samples.resize(count);
+
+	CubeModel::State state = CubeModel::initial();
+
+	const float h = referenceStep / referenceSubsteps;
+
+	for (int i=0; i<count; i++)
+	{
+		samples[i] = state;
+		for (int j=0; j<referenceSubsteps; j++)
+			rk4<CubeModel>(state, i*referenceStep + j*h, h);
+	}
+}
+
+/// Measure accuracy and cost of one integrator at one timestep.
+
+template <typename Model> Result measure(const char *integrator, void (*integrate)(typename Model::State&, float, float), float dt, const std::vector<typename Model::State> &samples)
+{
+	typedef typename Model::State State;
+
+	const int steps = (int) (duration / dt + 0.5f);
+	const int stride = (int) (dt / referenceStep + 0.5f);
+
+	Result result;
+	result.system = Model::name();
+	result.integrator = integrator;
+	result.dt = dt;
+
+	// accuracy pass
+
+	State state = Model::initial();
+
+	const double initialEnergy = Model::energy(state);
+
+	double error = 0;
+
+	for (int i=0; i<steps; i++)
+	{
+		integrate(state, i*dt, dt);
+
+		const double e = Model::error(state, samples[(i+1)*stride]);
+
+		if (e>error || e!=e)
+			error = e;
+	}
+
+	result.error = error;
+	result.drift = (Model::energy(state) - Model::energy(samples[steps*stride])) / initialEnergy;
+
+	// timing pass (no error measurement in the loop)
+
+	double best = 0;
+
+	for (int run=0; run<timingRuns; run++)
+	{
+		State state = Model::initial();
+
+		const double start = seconds();
+
+		for (int i=0; i<steps; i++)
+			integrate(state, i*dt, dt);
+
+		const double elapsed = seconds() - start;
+
+		if (run==0 || elapsed<best)
+			best = elapsed;
+
+		// keep the optimizer from discarding the integration
+
+		sink += Model::energy(state);
+	}
+
+	result.nanoseconds = best / steps * 1000000000.0;
+	result.cost = result.nanoseconds / dt * 0.001;
+
+	return result;
+}
+
+/// Sweep all integrators across all timesteps for a model.
+
+template <typename Model> void sweep(void (*rk4)(typename Model::State&, float, float), std::vector<Result> &results)
+{
+	typedef void (*Integrator)(typename Model::State&, float, float);
+
+	const int integratorCount = 4;
+
+	const char *names[integratorCount] = { "euler", "semi-implicit euler", "rk4", "dormand-prince" };
+
+	const Integrator integrators[integratorCount] = { euler<Model>, semiImplicitEuler<Model>, rk4, dormandPrince<Model> };
+
+	const int timestepCount = 7;
+
+	const float timesteps[timestepCount] = { 0.001f, 0.002f, 0.005f, 0.01f, 0.02f, 0.05f, 0.1f };
+
+	std::vector<typename Model::State> samples;
+	reference(samples);
+
+	for (int i=0; i<integratorCount; i++)
+	{
+		for (int j=0; j<timestepCount; j++)
+		{
+			Result result = measure<Model>(names[i], integrators[i], timesteps[j], samples);
+
+			printf("%-8s %-20s %8.3f %14.6g %14.6g %10.1f %12.1f\n", result.system, result.integrator, result.dt, result.error, result.drift, result.nanoseconds, result.cost);
+
+			results.push_back(result);
+		}
+	}
+}
+
+/// Report the cheapest integrator and timestep which meets the error budget.
+
+void cheapest(const std::vector<Result> &results, const char *system, double budget)
+{
+	int best = -1;
+
+	for (unsigned int i=0; i<results.size(); i++)
+	{
+		const Result &result = results[i];
+
+		if (strcmp(result.system, system)!=0 || !(result.error<=budget))
+			continue;
+
+		if (best<0 || result.cost<results[best].cost)
+			best = i;
+	}
+
+	if (best>=0)
+		printf("%s: %s at dt=%.3f (error %g, %.1f microseconds per simulated second)\n", system, results[best].integrator, results[best].dt, results[best].error, results[best].cost);
+	else
+		printf("%s: no integrator meets the error budget\n", system);
+}
+
+/// Measure one batch configuration and return states integrated per second.
+
+double throughput(std::vector<float> &x, std::vector<float> &v, int steps, float dt, int threads)
+{
+	const int count = (int) x.size();
+
+	double best = 0;
+
+	for (int run=0; run<timingRuns; run++)
+	{
+		const double start = seconds();
+
+		for (int i=0; i<steps; i++)
+		{
+			if (threads<0)
+			{
+				for (int j=0; j<count; j++)
+				{
+					State state;
+					state.x = x[j];
+					state.v = v[j];
+					integrate(state, i*dt, dt);
+					x[j] = state.x;
+					v[j] = state.v;
+				}
+			}
+			else
+			{
+				Batch::integrate(&x[0], &v[0], count, stiffness, damping, dt, threads);
+			}
+		}
+
+		const double elapsed = seconds() - start;
+
+		if (run==0 || elapsed<best)
+			best = elapsed;
+	}
+
+	sink += x[0] + v[count-1];
+
+	return (double) count * steps / best;
+}
+
+/// Compare the batched spring integrator against the scalar integrate() and measure throughput.
+
+void batch(int count)
+{
+	if (count<=0)
+		return;
+
+	const int steps = 10;
+	const float dt = 0.01f;
+
+	std::vector<float> x(count);
+	std::vector<float> v(count);
+
+	for (int i=0; i<count; i++)
+	{
+		x[i] = (float) (i % 2001) - 1000.0f;
+		v[i] = (float) (i % 101) - 50.0f;
+	}
+
+	// verify against scalar integrate()
+
+	std::vector<float> bx = x;
+	std::vector<float> bv = v;
+
+	for (int i=0; i<steps; i++)
+		Batch::integrate(&bx[0], &bv[0], count, stiffness, damping, dt);
+
+	double difference = 0;
+
+	for (int i=0; i<count; i++)
+	{
+		State state;
+		state.x = x[i];
+		state.v = v[i];
+
+		for (int j=0; j<steps; j++)
+			integrate(state, j*dt, dt);
+
+		const double scale = 1.0 + fabs(state.x) + fabs(state.v);
+		const double d = (fabs(state.x - bx[i]) + fabs(state.v - bv[i])) / scale;
+
+		if (d>difference)
+			difference = d;
+	}
+
+	printf("\nbatch of %d spring states, %d steps:\n", count, steps);
+	printf("maximum relative difference from integrate(): %g (%s)\n", difference, difference<=FLT_EPSILON*8 ? "ok" : "FAILED");
+
+	// measure throughput
+
+	printf("scalar integrate():      %8.1f million states/second\n", throughput(x, v, steps, dt, -1) * 0.000001);
+	printf("batch, one thread:       %8.1f million states/second\n", throughput(x, v, steps, dt, 1) * 0.000001);
+
+#ifdef _OPENMP
+	printf("batch, %2d threads:       %8.1f million states/second\n", omp_get_max_threads(), throughput(x, v, steps, dt, 0) * 0.000001);
+#endif
+}
+
+int main(int argc, char *argv[])
+{
+	const double budget = argc>1 ? atof(argv[1]) : 0.01;
+	const int states = argc>2 ? atoi(argv[2]) : 4*1024*1024;
+
+	printf("%-8s %-20s %8s %14s %14s %10s %12s\n", "system", "integrator", "dt", "max error", "energy drift", "ns/step", "us/second");
+
+	std::vector<Result> results;
+
+	// the spring uses the rk4 integrator from Integration.h, the cube has no such function
+
+	sweep<Spring>(integrate, results);
+	sweep<CubeModel>(rk4<CubeModel>, results);
+
+	printf("\ncheapest integrator with error <= %g:\n", budget);
+
+	cheapest(results, Spring::name(), budget);
+	cheapest(results, CubeModel::name(), budget);
+
+	batch(states);
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+// Simple RK4 integration framework
+// Copyright (c) 2004, Glenn Fiedler
+// http://www.gaffer.org/articles
+
+struct State
+{
+	float x;
+	float v;
+};
+
+struct Derivative
+{
+	float dx;
+	float dv;
+};
+
+const float stiffness = 10;		// spring constant k
+const float damping = 1;		// damping constant b
+
+float acceleration(const State &state, float t)
+{
+	const float k = stiffness;
+	const float b = damping;
+	return - k*state.x - b*state.v;
+}
+
+Derivative evaluate(const State &initial, float t)
+{
+	Derivative output;
+	output.dx = initial.v;
+	output.dv = acceleration(initial, t);
+	return output;
+}
+
+Derivative evaluate(const State &initial, float t, float dt, const Derivative &d)
+{
+	State state;
+	state.x = initial.x + d.dx*dt;
+	state.v = initial.v + d.dv*dt;
+	Derivative output;
+	output.dx = state.v;
+	output.dv = acceleration(state, t+dt);
+	return output;
+}
+
+void integrate(State &state, float t, float dt)
+{
+	Derivative a = evaluate(state, t);
+	Derivative b = evaluate(state, t, dt*0.5f, a);
+	Derivative c = evaluate(state, t, dt*0.5f, b);
+	Derivative d = evaluate(state, t, dt, c);
+
+	const float dxdt = 1.0f/6.0f * (a.dx + 2.0f*(b.dx + c.dx) + d.dx);
+	const float dvdt = 1.0f/6.0f * (a.dv + 2.0f*(b.dv + c.dv) + d.dv);
+	
+	state.x = state.x + dxdt*dt;
+	state.v = state.v + dvdt*dt;
+}
@@ -145,19 +145,11 @@ void closeDisplay(void)
 	window = 0;
 }
 
-float time()
+unsigned long long nanoseconds()
 {
-    static UInt64 start = 0;
-
-    if (start==0)
-    {
-        Microseconds((UnsignedWide*)&start);
-        return 0.0f;
-    }
-
     UInt64 counter = 0;
     Microseconds((UnsignedWide*)&counter);
-    return (counter - start) / 1000000.0f;
+    return counter * 1000;
 }
 
 #endif
@@ -12,15 +12,17 @@ using namespace Mathematics;
 bool openDisplay(const char title[], int width, int height, bool fullscreen = false);
 void updateDisplay();
 void closeDisplay();
-float time();
+unsigned long long nanoseconds();
 
 void onQuit();
 
 #include <vector>
 #include "Apple.h"
 #include "Windows.h"
+#include "Linux.h"
 #include "OpenGL.h"
 #include "Cube.h"
+#include "Scheduler.h"
 
 bool quit = false;
 
@@ -31,6 +33,18 @@ void onQuit()
 
 Cube cube;
 
+/// Steps the cube with the fixed timestep scheduler.
+
+struct Simulation : public Scheduler::Simulation
+{
+	void step(unsigned int tick, float dt)
+	{
+		cube.update(tick*dt, dt);
+	}
+};
+
+Simulation simulation;
+
 int main()
 {
 	const int width = 800;
@@ -41,38 +55,17 @@ int main()
 
 	initializeOpenGL();
 
-	const float dt = 0.01f;
-
-	float t = 0.0f;
-	float accumulator = 0.0f;
-	float currentTime = 0.0f;
+	Scheduler scheduler(0.01f);
 
 	while (!quit)
 	{
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 		
-		// update current time
-
-        float newTime = time();
-        float deltaTime = newTime - currentTime;
-
-        if (deltaTime<=0.0f)
-            continue;
-
-		currentTime = newTime;
-
-        // update discrete time
-
-		accumulator += deltaTime;
+		// update discrete time
 
-		while (accumulator>=dt)
-        {
-			cube.update(t, dt);
-            accumulator -= dt;
-            t += dt;
-        }
+		scheduler.update(simulation);
 
-		cube.render();
+		cube.render(scheduler.alpha());
 
         // update display
 
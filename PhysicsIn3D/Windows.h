@@ -193,21 +193,22 @@ void closeDisplay()
     window = 0;
 }
 
-float time()
+unsigned long long nanoseconds()
 {
-    static __int64 start = 0;
-    static __int64 frequency = 0;
+    static unsigned __int64 frequency = 0;
 
-    if (start==0)
-    {
-        QueryPerformanceCounter((LARGE_INTEGER*)&start);
+    if (frequency==0)
         QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
-        return 0.0f;
-    }
 
-    __int64 counter = 0;
+    unsigned __int64 counter = 0;
     QueryPerformanceCounter((LARGE_INTEGER*)&counter);
-    return (float) ((counter - start) / double(frequency));
+
+    // split into whole seconds and remainder so the conversion cannot overflow
+
+    const unsigned __int64 seconds = counter / frequency;
+    const unsigned __int64 remainder = counter % frequency;
+
+    return seconds * 1000000000 + remainder * 1000000000 / frequency;
 }
 
 // naughty! :)
@@ -7,6 +7,7 @@
 #include <OpenGL/gl.h>
 #include <OpenGL/glu.h>
 #include <OpenGL/glext.h>
+#include <libkern/OSAtomic.h>
 
 static AGLContext setupAGL(WindowRef window)
 {	
@@ -144,19 +145,27 @@ void closeDisplay(void)
 	window = 0;
 }
 
-float time()
+unsigned long long nanoseconds()
 {
-    static UInt64 start = 0;
+    UInt64 counter = 0;
+    Microseconds((UnsignedWide*)&counter);
+    return counter * 1000;
+}
 
-    if (start==0)
+int atomicExchange(volatile int *value, int exchange)
+{
+    int previous;
+    do
     {
-        Microseconds((UnsignedWide*)&start);
-        return 0.0f;
+        previous = *value;
     }
+    while (!OSAtomicCompareAndSwap32Barrier(previous, exchange, value));
+    return previous;
+}
 
-    UInt64 counter = 0;
-    Microseconds((UnsignedWide*)&counter);
-    return (counter - start) / 1000000.0f;
+int atomicLoad(volatile int *value)
+{
+    return OSAtomicAdd32Barrier(0, value);
 }
 
 #endif
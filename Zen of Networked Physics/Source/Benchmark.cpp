@@ -0,0 +1,721 @@
+// Cube rendering benchmark
+// Copyright (c) Glenn Fiedler 2004
+// http://www.gaffer.org/articles
+//
+// Renders 1, 100 and 10000 cubes per frame with the batched CubeRenderer and
+// with the old immediate mode path (glBegin/glEnd per cube), reporting draw
+// calls and CPU submit time per frame for the cubes alone, then with shadow
+// volumes rendered for every cube. Then renders a world ten times wider,
+// mostly out of view, with and without frustum culling.
+//
+// Then runs the hot physics functions on their own, reporting time per call
+// and, where Linux hardware performance counters are available, cycles,
+// instructions, cache misses and branch misses per call. Counters are usually
+// unavailable in containers, see Counters.
+//
+// Last it records a cube flying over the scattered cubes for lag compensation,
+// rewinds one latency and checks that a ray through where the cube was then
+// hits it while a ray through where it is now misses, then times the rewound
+// raycast. The benchmark exits with 1 if either check fails.
+//
+// On Linux define HEADLESS to render offscreen through EGL, which runs against
+// Mesa's software rasterizer without a display:
+//
+//   g++ -O2 -DHEADLESS Benchmark.cpp -o Benchmark -lEGL -lGL -lGLU
+
+#pragma warning( disable : 4127 )  // conditional expression is constant
+#pragma warning( disable : 4100 )  // unreferenced formal parameter
+#pragma warning( disable : 4244 )  // double to float
+#pragma warning( disable : 4996 )  // stupid deprecated warnings
+
+const float timestep = 0.01f;
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Mathematics.h"
+#include "Vector.h"
+#include "Matrix.h"
+#include "Quaternion.h"
+
+using namespace Mathematics;
+
+// platform specific functions
+
+bool openDisplay(const char title[], int width, int height, bool fullscreen = false);
+void updateDisplay();
+void closeDisplay();
+void drawText(float x, float y, const char text[], Vector color = Vector(1,1,1), float alpha = 1);
+unsigned long long nanoseconds();
+
+enum Key
+{
+    Left,
+    Right,
+    Up,
+    Down,
+    Space,
+    Enter,
+    Control,
+    Esc,
+    PageUp,
+    PageDown,
+    F1,
+    F2,
+    F3,
+    F4,
+    F5,
+    F6,
+    F7,
+    F8,
+    F9,
+    F10,
+};
+
+void onKeyUp(Key key) {}
+void onKeyDown(Key key) {}
+void onQuit() {}
+
+#include <vector>
+#include <algorithm>
+#include "Apple.h"
+#include "Windows.h"
+#include "Linux.h"
+#include "Headless.h"
+
+#include "Plane.h"
+#include "Image.h"
+#include "OpenGL.h"
+#include "RingBuffer.h"
+#include "Trace.h"
+
+Trace trace;
+
+#include "Profiler.h"
+
+Profiler profiler;
+
+#include "Cube.h"
+#include "CubeRenderer.h"
+#include "Move.h"
+#include "Snapshot.h"
+#include "Scene.h"
+#include "InputWindow.h"
+#include "History.h"
+#include "LagCompensation.h"
+#include "Counters.h"
+
+/// Seconds between two nanosecond clock readings.
+
+double elapsed(unsigned long long start, unsigned long long finish)
+{
+    return (finish - start) * 0.000000001;
+}
+
+/// test and render edge a-b if its a silhouette edge relative to light
+
+void immediateSilhouette(const Vector &light, Vector a, Vector b)
+{
+    // determine edge normals
+
+    Vector midpoint = (a + b) * 0.5f;
+
+    Vector leftNormal;
+
+    if (midpoint.x!=0)
+        leftNormal = Vector(midpoint.x, 0, 0);
+    else
+        leftNormal = Vector(0, midpoint.y, 0);
+
+    Vector rightNormal = midpoint - leftNormal;
+
+    // check if silhouette edge
+
+    const Vector differenceA = a - light;
+
+    const float leftDot = leftNormal.dot(differenceA);
+    const float rightDot = rightNormal.dot(differenceA);
+
+    if ((leftDot<0 && rightDot>0) || (leftDot>0 && rightDot<0))
+    {
+        // extrude quad
+
+        const Vector differenceB = b - light;
+
+        Vector _a = a + differenceA * 100;
+        Vector _b = b + differenceB * 100;
+
+        // ensure correct winding order for silhouette edge
+
+        const Vector cross = (b - a).cross(differenceA);
+
+        if (cross.dot(a)<0)
+        {
+            Vector t = a;
+            a = b;
+            b = t;
+
+            t = _a;
+            _a = _b;
+            _b = t;
+        }
+
+        // render extruded quad
+
+        glVertex3f(a.x, a.y, a.z);
+        glVertex3f(b.x, b.y, b.z);
+        glVertex3f(_b.x, _b.y, _b.z);
+        glVertex3f(_a.x, _a.y, _a.z);
+    }
+}
+
+/// render shadow volume in immediate mode
+
+void immediateShadowVolume(const Cube::State &state, const Vector &light)
+{
+    glBegin(GL_QUADS);
+
+    const float s = state.size * 0.5f;
+
+    immediateSilhouette(light, Vector(-s,+s,-s), Vector(+s,+s,-s));
+    immediateSilhouette(light, Vector(+s,+s,-s), Vector(+s,+s,+s));
+    immediateSilhouette(light, Vector(+s,+s,+s), Vector(-s,+s,+s));
+    immediateSilhouette(light, Vector(-s,+s,+s), Vector(-s,+s,-s));
+
+    immediateSilhouette(light, Vector(-s,-s,-s), Vector(+s,-s,-s));
+    immediateSilhouette(light, Vector(+s,-s,-s), Vector(+s,-s,+s));
+    immediateSilhouette(light, Vector(+s,-s,+s), Vector(-s,-s,+s));
+    immediateSilhouette(light, Vector(-s,-s,+s), Vector(-s,-s,-s));
+
+    immediateSilhouette(light, Vector(-s,+s,-s), Vector(-s,-s,-s));
+    immediateSilhouette(light, Vector(+s,+s,-s), Vector(+s,-s,-s));
+    immediateSilhouette(light, Vector(+s,+s,+s), Vector(+s,-s,+s));
+    immediateSilhouette(light, Vector(-s,+s,+s), Vector(-s,-s,+s));
+
+    glEnd();
+}
+
+/// Render the shadow volume of a single cube the old way, with two stencil passes
+/// per cube each testing every edge for silhouette.
+
+void immediateShadow(const Cube::State &state, const Vector &light)
+{
+    glPushMatrix();
+
+    glTranslatef(state.position.x, state.position.y, state.position.z);
+
+    float angle;
+    Mathematics::Vector axis;
+    state.orientation.angleAxis(angle, axis);
+    glRotatef(angle/Mathematics::pi*180, axis.x, axis.y, axis.z);
+
+    // enter state for rendering shadow volumes to stencil
+
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glDepthMask(GL_FALSE);
+
+    glEnable(GL_STENCIL_TEST);
+
+    Vector bodySpaceLight = state.worldToBody * light;
+
+    // render front faces
+
+    glStencilFunc(GL_ALWAYS, 0x0, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+
+    immediateShadowVolume(state, bodySpaceLight);
+
+    // render shadow volume back faces
+
+    glCullFace(GL_FRONT);
+    glStencilFunc(GL_ALWAYS, 0x0, 0xff);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
+
+    immediateShadowVolume(state, bodySpaceLight);
+
+    // restore normal rendering state
+
+    glCullFace(GL_BACK);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+
+    glDisable(GL_STENCIL_TEST);
+
+    glPopMatrix();
+}
+
+/// Render a cube the old way, in immediate mode with per cube material and state changes.
+
+void immediate(const Cube::State &state, float r, float g, float b, float a, const Vector &light, bool shadows)
+{
+    glPushMatrix();
+
+    glTranslatef(state.position.x, state.position.y, state.position.z);
+
+    float angle;
+    Mathematics::Vector axis;
+    state.orientation.angleAxis(angle, axis);
+    glRotatef(angle/Mathematics::pi*180, axis.x, axis.y, axis.z);
+
+    GLfloat color[] = { r, g, b, a };
+
+    glMaterialfv(GL_FRONT, GL_AMBIENT, color);
+    glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
+
+    glEnable(GL_LIGHTING);
+    glDepthFunc(GL_ALWAYS);
+
+    const float s = state.size * 0.5f;
+
+    glBegin(GL_QUADS);
+        glNormal3f(0,0,+1); glVertex3f(-s,-s,+s); glVertex3f(+s,-s,+s); glVertex3f(+s,+s,+s); glVertex3f(-s,+s,+s);
+        glNormal3f(0,0,-1); glVertex3f(-s,-s,-s); glVertex3f(-s,+s,-s); glVertex3f(+s,+s,-s); glVertex3f(+s,-s,-s);
+        glNormal3f(0,+1,0); glVertex3f(-s,+s,-s); glVertex3f(-s,+s,+s); glVertex3f(+s,+s,+s); glVertex3f(+s,+s,-s);
+        glNormal3f(0,-1,0); glVertex3f(-s,-s,-s); glVertex3f(+s,-s,-s); glVertex3f(+s,-s,+s); glVertex3f(-s,-s,+s);
+        glNormal3f(+1,0,0); glVertex3f(+s,-s,-s); glVertex3f(+s,+s,-s); glVertex3f(+s,+s,+s); glVertex3f(+s,-s,+s);
+        glNormal3f(-1,0,0); glVertex3f(-s,-s,-s); glVertex3f(-s,-s,+s); glVertex3f(-s,+s,+s); glVertex3f(-s,+s,-s);
+    glEnd();
+
+    glDepthFunc(GL_LEQUAL);
+    glDisable(GL_LIGHTING);
+
+    glPopMatrix();
+
+    if (shadows)
+        immediateShadow(state, light);
+}
+
+/// Scatter cubes over the ground in front of the camera.
+/// @param spread scale applied to the area covered.
+
+void scatter(std::vector<Cube::State> &states, int count, float spread = 1.0f)
+{
+    srand(1);
+
+    Cube cube;
+
+    states.resize(count);
+
+    for (int i=0; i<count; i++)
+    {
+        Cube::State &state = states[i];
+        state = cube.state();
+        state.size = 0.2f + 0.3f * rand() / (float) RAND_MAX;
+        state.position = Vector((-4.0f + 8.0f * rand() / (float) RAND_MAX) * spread, 0.5f + 2.0f * rand() / (float) RAND_MAX, (-6.0f + 8.0f * rand() / (float) RAND_MAX) * spread);
+        state.orientation = Quaternion(6.28f * rand() / (float) RAND_MAX, Vector(rand() / (float) RAND_MAX, 1, rand() / (float) RAND_MAX).unit());
+        state.recalculate();
+    }
+}
+
+/// Print time and hardware counts per call for a physics scenario.
+/// Counts that are unavailable are shown as -.
+
+void report(const char name[], const Counters &counters, int calls, double seconds)
+{
+    printf("%-24s   %7d   %8.0f", name, calls, seconds / calls * 1000000000);
+
+    double counts[Counters::CounterCount];
+    bool available[Counters::CounterCount];
+
+    for (int i=0; i<Counters::CounterCount; i++)
+        available[i] = counters.read((Counters::Counter) i, counts[i]);
+
+    if (available[Counters::Cycles])
+        printf("   %6.0f", counts[Counters::Cycles] / calls);
+    else
+        printf("   %6s", "-");
+
+    if (available[Counters::Instructions])
+        printf("   %12.0f", counts[Counters::Instructions] / calls);
+    else
+        printf("   %12s", "-");
+
+    if (available[Counters::Cycles] && available[Counters::Instructions] && counts[Counters::Cycles]>0)
+        printf("   %4.2f", counts[Counters::Instructions] / counts[Counters::Cycles]);
+    else
+        printf("   %4s", "-");
+
+    if (available[Counters::CacheMisses])
+        printf("   %12.2f", counts[Counters::CacheMisses] / calls);
+    else
+        printf("   %12s", "-");
+
+    if (available[Counters::BranchMisses])
+        printf("   %13.2f", counts[Counters::BranchMisses] / calls);
+    else
+        printf("   %13s", "-");
+
+    printf("\n");
+}
+
+int main()
+{
+    if (!openDisplay("Cube Rendering Benchmark", 800, 600))
+    {
+        printf("could not open display\n");
+        return 1;
+    }
+
+    initializeOpenGL();
+
+    GLfloat lightPosition[] = { -2, 10, 5, 1 };
+    glLightfv(GL_LIGHT0, GL_POSITION, lightPosition);
+    glEnable(GL_LIGHT0);
+
+    const Vector light(lightPosition[0], lightPosition[1], lightPosition[2]);
+
+    // three materials, as in the networked physics view
+
+    const float colors[3][4] =
+    {
+        { 1.0f, 1.0f, 1.0f, 1.0f },
+        { 0.8f, 0.4f, 0.3f, 1.0f },
+        { 0.4f, 0.3f, 0.8f, 1.0f }
+    };
+
+    printf("%s\n\n", (const char*) glGetString(GL_RENDERER));
+    printf("cubes   shadows   renderer    draw calls   submit ms   frame ms\n");
+
+    const int counts[] = { 1, 100, 10000 };
+
+    CubeRenderer renderer;
+
+    std::vector<Cube::State> states;
+
+    for (int shadows=0; shadows<2; shadows++)
+    for (int c=0; c<3; c++)
+    {
+        scatter(states, counts[c]);
+
+        const int frames = counts[c]<10000 ? 20 : 5;
+
+        renderer.shadows = shadows!=0;
+
+        for (int batched=0; batched<2; batched++)
+        {
+            double submit = 0;
+            double total = 0;
+            int drawCalls = 0;
+
+            for (int frame=0; frame<frames; frame++)
+            {
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+                const unsigned long long start = nanoseconds();
+
+                if (batched)
+                {
+                    renderer.begin();
+
+                    for (unsigned int i=0; i<states.size(); i++)
+                    {
+                        const float *color = colors[i%3];
+                        renderer.add(states[i], color[0], color[1], color[2], color[3]);
+                    }
+
+                    renderer.render(light);
+
+                    drawCalls = renderer.stats().drawCalls;
+                }
+                else
+                {
+                    for (unsigned int i=0; i<states.size(); i++)
+                    {
+                        const float *color = colors[i%3];
+                        immediate(states[i], color[0], color[1], color[2], color[3], light, shadows!=0);
+                    }
+
+                    drawCalls = (int) states.size() * (shadows ? 3 : 1);
+                }
+
+                const unsigned long long submitted = nanoseconds();
+
+                glFinish();
+
+                const unsigned long long finished = nanoseconds();
+
+                updateDisplay();
+
+                submit += elapsed(start, submitted);
+                total += elapsed(start, finished);
+            }
+
+            printf("%5d   %-7s   %-9s   %10d   %9.3f   %8.3f\n", counts[c], shadows ? "on" : "off", batched ? "batched" : "immediate", drawCalls, submit / frames * 1000, total / frames * 1000);
+        }
+    }
+
+    // wide world, most cubes out of view
+
+    printf("\nwide world   renderer    cubes drawn   shadows   culled   submit ms   frame ms\n");
+
+    scatter(states, 10000, 10.0f);
+
+    renderer.shadows = true;
+
+    Frustum frustum;
+    frustum.calculate();
+
+    for (int culled=0; culled<2; culled++)
+    {
+        const int frames = 5;
+
+        double submit = 0;
+        double total = 0;
+
+        for (int frame=0; frame<frames; frame++)
+        {
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+
+            const unsigned long long start = nanoseconds();
+
+            if (culled)
+                renderer.begin(frustum);
+            else
+                renderer.begin();
+
+            for (unsigned int i=0; i<states.size(); i++)
+            {
+                const float *color = colors[i%3];
+                renderer.add(states[i], color[0], color[1], color[2], color[3]);
+            }
+
+            renderer.render(light);
+
+            const unsigned long long submitted = nanoseconds();
+
+            glFinish();
+
+            const unsigned long long finished = nanoseconds();
+
+            updateDisplay();
+
+            submit += elapsed(start, submitted);
+            total += elapsed(start, finished);
+        }
+
+        const CubeRenderer::Statistics &stats = renderer.stats();
+
+        printf("%10d   %-9s   %11d   %7d   %6d   %9.3f   %8.3f\n", (int) states.size(), culled ? "culled" : "batched", stats.cubes, stats.shadows, stats.culled, submit / frames * 1000, total / frames * 1000);
+    }
+
+    // physics functions in isolation, collision is reached through Cube::calculateForces 
+    // since it is private to the cube. the RK4 integrator is private too, so it is timed
+    // through Cube::update, which also includes the profiler timer around each update
+
+    printf("\nphysics                      calls    ns/call   cycles   instructions    IPC   cache misses   branch misses\n");
+
+    Counters counters;
+
+    Scene scene;
+    scene.initialize();
+
+    scatter(states, 1000);
+
+    // cubes resting on the floor so their lower corners collide
+
+    std::vector<Cube::State> resting = states;
+
+    for (unsigned int i=0; i<resting.size(); i++)
+    {
+        resting[i].position.y = resting[i].size * 0.45f;
+        resting[i].recalculate();
+    }
+
+    Cube::Input input;
+    input.left = false;
+    input.right = false;
+    input.forward = false;
+    input.back = false;
+    input.jump = false;
+
+    {
+        const int repeats = 100;
+
+        counters.reset();
+        const unsigned long long start = nanoseconds();
+        counters.start();
+
+        for (int r=0; r<repeats; r++)
+        {
+            for (unsigned int i=0; i<states.size(); i++)
+                states[i].recalculate();
+        }
+
+        counters.stop();
+        report("State::recalculate", counters, repeats * (int) states.size(), elapsed(start, nanoseconds()));
+    }
+
+    {
+        const int repeats = 100;
+
+        Vector force;
+        Vector torque;
+        Vector total(0,0,0);
+
+        counters.reset();
+        const unsigned long long start = nanoseconds();
+        counters.start();
+
+        for (int r=0; r<repeats; r++)
+        {
+            for (unsigned int i=0; i<resting.size(); i++)
+            {
+                Cube::calculateForces(input, scene.planes, resting[i], force, torque);
+                total += force;
+            }
+        }
+
+        counters.stop();
+        report("Cube::collision", counters, repeats * (int) resting.size(), elapsed(start, nanoseconds()));
+
+        if (total.x==12345.0f)
+            printf("\n");              // keep the forces live
+    }
+
+    {
+        const int ticks = 100;
+
+        std::vector<Cube> cubes(resting.size());
+
+        for (unsigned int i=0; i<cubes.size(); i++)
+        {
+            cubes[i].integrator = Cube::RK4;
+            cubes[i].snap(resting[i]);
+        }
+
+        counters.reset();
+        const unsigned long long start = nanoseconds();
+        counters.start();
+
+        for (int t=0; t<ticks; t++)
+        {
+            for (unsigned int i=0; i<cubes.size(); i++)
+                cubes[i].update(input, scene.planes, timestep);
+        }
+
+        counters.stop();
+        report("Cube::update (RK4)", counters, ticks * (int) cubes.size(), elapsed(start, nanoseconds()));
+    }
+
+    {
+        // record moves of a cube sliding across the floor, then correct the
+        // oldest so every correction replays the rest
+
+        const int moves = 100;
+        const int corrections = 200;
+
+        while (scene.time<300)
+            scene.update(scene.time);
+
+        scene.input.left = true;
+
+        const unsigned int first = scene.time;
+
+        Cube::State corrected = scene.cube.state();
+        corrected.position.x += 0.1f;
+        corrected.recalculate();
+
+        History history;
+
+        for (int i=0; i<moves; i++)
+        {
+            Move move;
+            move.time = scene.time;
+            move.setInput(scene.input);
+            move.store(scene.cube.state());
+
+            history.add(move);
+
+            scene.update(scene.time);
+        }
+
+        counters.reset();
+        double seconds = 0.0;
+
+        for (int i=0; i<corrections; i++)
+        {
+            History replay = history;
+            Scene target = scene;
+
+            const unsigned long long start = nanoseconds();
+            counters.start();
+
+            replay.correction(target, first, corrected, scene.input);
+
+            counters.stop();
+            seconds += elapsed(start, nanoseconds());
+        }
+
+        report("History::correction", counters, corrections, seconds);
+    }
+
+    // lag compensation, a cube flies over the resting cubes at 20 meters per second
+
+    bool rewound = true;
+
+    {
+        const int ticks = 100;
+        const int queries = 10000;
+        const float latency = 0.1f;
+        const int flying = (int) resting.size();
+
+        LagCompensation lag;
+
+        Cube cube;
+        Cube::State state = cube.state();
+        state.size = 1.0f;
+        state.orientation = Quaternion(1,0,0,0);
+
+        for (int t=0; t<ticks; t++)
+        {
+            state.position = Vector(-10.0f + t * 0.2f, 10.0f, 0.0f);
+            state.recalculate();
+
+            lag.begin(t);
+
+            for (unsigned int i=0; i<resting.size(); i++)
+                lag.add(i, resting[i]);
+
+            lag.add(flying, state);
+        }
+
+        // shoot along -z through where the cube was one latency ago and where it is now
+
+        const unsigned int now = ticks - 1;
+        const unsigned int then = lag.rewind(now, latency);
+
+        const Vector past = lag.frame(then)->back().position + Vector(0,0,20);
+        const Vector present = state.position + Vector(0,0,20);
+        const Vector direction(0,0,-1);
+
+        LagCompensation::Hit hit;
+
+        const bool hitPast = lag.raycast(then, past, direction, 100.0f, hit) && hit.id==flying;
+        const bool missPresent = !lag.raycast(then, present, direction, 100.0f, hit);
+
+        rewound = now - then == 10 && hitPast && missPresent;
+
+        int hits = 0;
+
+        counters.reset();
+        const unsigned long long start = nanoseconds();
+        counters.start();
+
+        for (int i=0; i<queries; i++)
+            hits += lag.raycast(then, past, direction, 100.0f, hit);
+
+        counters.stop();
+        report("LagCompensation::raycast", counters, queries, elapsed(start, nanoseconds()));
+
+        printf("\nlag compensation rewound %u ticks: hit where the cube was %s, miss where it is now %s (%s)\n", now - then, hitPast ? "yes" : "no", missPresent ? "yes" : "no", rewound && hits==queries ? "ok" : "FAILED");
+
+        rewound = rewound && hits==queries;
+    }
+
+    if (!counters.available())
+        printf("\nhardware counters unavailable: %s\n", counters.reason());
+
+    closeDisplay();
+
+    return rewound ? 0 : 1;
+}
@@ -21,12 +21,14 @@ struct Client : public Scene
 
     void update(unsigned int t)
     {
+        Profiler::Timer timer(profiler, Profiler::ClientUpdate);
+
         // add to history
 
         Move move;
         move.time = t;
-        move.input = input;
-        move.state = cube.state();
+        move.setInput(input);
+        move.store(cube.state());
 
         history.add(move);
 
@@ -43,8 +45,8 @@ struct Client : public Scene
 
         history.correction(*this, t, state, input);
 
-        if (original.compare(cube.state()))
-            smooth();
+        if (original!=cube.state())
+            smooth(original);
     }
 
     History history;        ///< client side history of moves
@@ -0,0 +1,71 @@
+// Image comparison for visual regression testing
+// Copyright (c) Glenn Fiedler 2004
+// http://www.gaffer.org/articles
+//
+// Compares a rendered frame against a reference image, both binary PPM files
+// as written by the offscreen mode of NetworkedPhysics, and fails if more
+// pixels than allowed differ by more than the channel tolerance.
+//
+//   Compare <image.ppm> <reference.ppm> [tolerance] [max differing pixels] [diff.ppm]
+//
+// Returns 0 if the images match, 1 if they differ and 2 on error. A typical
+// check on a machine with no display:
+//
+//   g++ -O2 -DHEADLESS -I. NetworkedPhysics.cpp FreeType.cpp -o NetworkedPhysics -lEGL -lGL -lGLU -lfreetype -lpthread
+//   g++ -O2 Compare.cpp -o Compare
+//   ./NetworkedPhysics 800 reference.ppm              (before the change)
+//   ./NetworkedPhysics 800 frame.ppm                  (after the change)
+//   ./Compare frame.ppm reference.ppm 2 0 diff.ppm
+
+#pragma warning( disable : 4996 )  // stupid deprecated warnings
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+#include "Image.h"
+
+int main(int argc, char *argv[])
+{
+    if (argc<3)
+    {
+        printf("usage: %s image.ppm reference.ppm [tolerance] [max differing pixels] [diff.ppm]\n", argv[0]);
+        return 2;
+    }
+
+    const int tolerance = argc>3 ? atoi(argv[3]) : 0;
+    const int allowed = argc>4 ? atoi(argv[4]) : 0;
+
+    Image image;
+    Image reference;
+
+    if (!image.read(argv[1]))
+    {
+        printf("could not read %s\n", argv[1]);
+        return 2;
+    }
+
+    if (!reference.read(argv[2]))
+    {
+        printf("could not read %s\n", argv[2]);
+        return 2;
+    }
+
+    Image diff;
+    Image::Difference difference;
+
+    if (!Image::compare(image, reference, tolerance, difference, argc>5 ? &diff : 0))
+    {
+        printf("size mismatch: %dx%d vs %dx%d\n", image.width, image.height, reference.width, reference.height);
+        return 1;
+    }
+
+    if (argc>5 && !diff.write(argv[5]))
+        printf("could not write %s\n", argv[5]);
+
+    const bool passed = difference.pixels<=allowed;
+
+    printf("%s: %d pixels differ by more than %d, maximum difference %d, mean %.4f\n", passed ? "match" : "MISMATCH", difference.pixels, tolerance, difference.maximum, difference.mean);
+
+    return passed ? 0 : 1;
+}
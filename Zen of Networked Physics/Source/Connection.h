@@ -5,6 +5,11 @@
 /// Effectively this object simulates a two way connection from client to server,
 /// the client sends a stream of input to the server, while the server sends a stream
 /// of corrections back to the client.
+/// Corrections are sent as snapshots on a fixed interval. Each snapshot packet is
+/// filled with body updates in relevancy priority order until the packet size is
+/// reached, bodies that do not fit keep their priority and are sent in a later packet.
+/// When the proxy uses dead reckoning the server mirrors its prediction and only
+/// forwards the body to the proxy when the prediction error exceeds the budget.
 
 class Connection
 {
@@ -12,6 +17,26 @@ public:
 
     float latency;          ///< each way latency in seconds
     float packetLoss;       ///< percentage of packets lost
+    int packetSize;         ///< maximum size of a snapshot packet in bytes (mtu)
+    int snapshotInterval;   ///< number of ticks between snapshots sent from server to client
+
+    Relevancy relevancy;    ///< decides which server bodies are sent to the client
+
+    static const int headerSize = 8;        ///< bytes of snapshot packet header (time and body count)
+
+    /// Snapshot statistics.
+
+    struct Statistics
+    {
+        int bytesSent;                      ///< bytes sent from server to client during the last tick.
+        float averageBytesSent;             ///< moving average of bytes sent per tick.
+        int bodiesSent;                     ///< body updates sent during the last tick.
+        int bodiesDeferred;                 ///< relevant bodies that did not fit in the last snapshot.
+        float averageStaleness;             ///< average ticks since each body was last sent.
+        unsigned int maximumStaleness;      ///< ticks since the stalest body was last sent.
+        unsigned int remoteSent;            ///< dead reckoning updates sent to the proxy.
+        unsigned int remoteSkipped;         ///< dead reckoning updates skipped because the proxy prediction was within budget.
+    };
 
     Connection()
     {
@@ -23,8 +48,15 @@ public:
 
         latency = 0.0f;
         packetLoss = 0.0f;
+        packetSize = 1200;
+        snapshotInterval = 1;
         
         time = 0;
+        snapshotTime = 0;
+        ack = 0;
+        remotePending = 0;
+
+        memset(&statistics, 0, sizeof(statistics));
 
         #ifdef LOGGING
         logfile = fopen("sync.log", "w");
@@ -47,10 +79,16 @@ public:
         this->client = &client;
         this->server = &server;
         this->proxy = &proxy;
+
+        // the client controls server body 0
+
+        observer.body = 0;
     }
 
     void update(unsigned int t)
     {
+        Profiler::Timer timer(profiler, Profiler::ConnectionUpdate);
+
         // update time
 
         time = t;
@@ -60,55 +98,215 @@ public:
         process(clientToServer);
         process(serverToClient);
 
-        // send input event to server
+        // update server
+
+        server->update(time);
+
+        // send snapshot from server to client
+
+        statistics.bytesSent = 0;
+        statistics.bodiesSent = 0;
+
+        if (snapshotInterval<=1 || time%snapshotInterval==0)
+            snapshot();
+
+        statistics.averageBytesSent += (statistics.bytesSent - statistics.averageBytesSent) * 0.05f;
+
+        // send input event to server with all input not yet acked
 
         InputEvent *event = new InputEvent();
 
-        event->time = client->time;
-        event->input = client->input;
-        client->history.importantMoveArray(event->importantMoves);
+        client->history.inputs(ack, event->window, 1);
+
+        if (event->window.count==0)
+            event->window.clear(client->time);
+
+        event->window.add(client->input);
+
         insert(clientToServer, event);
 
+        trace.instant("input sent", Profiler::Simulation, "inputs", event->window.count);
+
         // step ahead
 
         time ++;
     }
 
+    /// get snapshot statistics
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+    /// get the number of ticks since a body was last sent to the client
+
+    unsigned int staleness(int id) const
+    {
+        if (id<0 || id>=(int)lastSent.size())
+            return 0;
+
+        return time - lastSent[id];
+    }
+
 protected:
 
     /// input event recieved on server side
 
-    void input(unsigned int t, Cube::Input &input, const std::vector<Move> &importantMoves)
+    void input(const InputWindow &window)
+    {
+        // buffer input on server
+
+        server->receive(time, window);
+    }
+
+    /// send a snapshot of the server bodies to the client side.
+    /// bodies are added in priority order until the packet is full.
+
+    void snapshot()
     {
-        // update server with input
+        // nothing new to send unless the server has advanced
+
+        if (server->time==snapshotTime)
+            return;
+
+        snapshotTime = server->time;
+
+        // select bodies relevant to the client
+
+        server->bodies(bodies);
+
+        relevancy.update(bodies);
+
+        observer.position = server->cube.state().position;
+
+        const int bytes = relevancy.select(observer, packetSize - headerSize, selected);
+
+        statistics.bodiesDeferred = relevancy.relevant() - (int) selected.size();
+
+        // update staleness
+
+        for (unsigned int i=0; i<bodies.size(); i++)
+        {
+            if (bodies[i].id>=(int)lastSent.size())
+                lastSent.resize(bodies[i].id+1, 0);
+        }
+
+        for (unsigned int i=0; i<selected.size(); i++)
+            lastSent[selected[i]] = time;
+
+        statistics.averageStaleness = 0.0f;
+        statistics.maximumStaleness = 0;
 
-        server->update(t, input, importantMoves);
+        for (unsigned int i=0; i<bodies.size(); i++)
+        {
+            const unsigned int ticks = staleness(bodies[i].id);
+
+            statistics.averageStaleness += ticks;
+
+            if (ticks>statistics.maximumStaleness)
+                statistics.maximumStaleness = ticks;
+        }
+
+        if (bodies.size())
+            statistics.averageStaleness /= bodies.size();
+
+        if (selected.empty())
+            return;
 
         // send sync event back to client side
 
         SyncEvent *event = new SyncEvent();
         event->time = server->time;
-        event->state = server->cube.state();
-        event->input = input;
+        event->ack = server->ack;
+        event->updates.resize(selected.size());
+
+        for (unsigned int i=0; i<selected.size(); i++)
+        {
+            BodyUpdate &update = event->updates[i];
+            update.id = selected[i];
+            server->body(update.id, update.state, update.input);
+            update.remote = remote(update.id, update.state, update.input);
+        }
+
         insert(serverToClient, event);
 
+        statistics.bytesSent += headerSize + bytes;
+        statistics.bodiesSent += (int) selected.size();
+
         #ifdef LOGGING
         if (logfile)
         {
-            Vector position = event->state.position;
-            Quaternion orientation = event->state.orientation;
-            Cube::Input input = event->input;
-            fprintf(logfile, "%d: position=(%f,%f,%f), orientation=(%f,%f,%f,%f), input=(%d,%d,%d,%d,%d)\n", event->time, position.x, position.y, position.z, orientation.w, orientation.x, orientation.y, orientation.z, input.left, input.right, input.forward, input.back, input.jump);
+            for (unsigned int i=0; i<event->updates.size(); i++)
+            {
+                Vector position = event->updates[i].state.position;
+                Quaternion orientation = event->updates[i].state.orientation;
+                Cube::Input input = event->updates[i].input;
+                fprintf(logfile, "%d: id=%d, position=(%f,%f,%f), orientation=(%f,%f,%f,%f), input=(%d,%d,%d,%d,%d)\n", event->time, event->updates[i].id, position.x, position.y, position.z, orientation.w, orientation.x, orientation.y, orientation.z, input.left, input.right, input.forward, input.back, input.jump);
+            }
         }
         #endif
     }
 
+    /// check if a body update should be forwarded to the proxy.
+    /// in dead reckoning mode the update is only needed when the proxy prediction,
+    /// mirrored here on the server side, has drifted too far from the server state.
+    /// the mirror is only reset once an update reaches the proxy. while an update is
+    /// in flight no other is sent, and if it is lost the next snapshot sends again.
+
+    bool remote(int id, const Cube::State &state, const Cube::Input &input)
+    {
+        if (proxy->mode!=Proxy::DeadReckoning || id!=0)
+            return true;
+
+        mirror.predict(server->time, server->planes);
+
+        if (!mirror.exceeded(state))
+        {
+            statistics.remoteSkipped++;
+            return false;
+        }
+
+        if (remotePending && time<remotePending)
+            return false;
+
+        remotePending = time + (unsigned int) (latency/timestep);
+
+        statistics.remoteSent++;
+        return true;
+    }
+
+    /// acknowledge client input received by the server
+
+    void acknowledge(unsigned int ack)
+    {
+        if (ack>this->ack)
+            this->ack = ack;
+    }
+
     /// synchronize event received on client side
 
-    void synchronize(unsigned int t, const Cube::State &state, const Cube::Input &input)
+    void synchronize(unsigned int t, int id, const Cube::State &state, const Cube::Input &input, bool remote)
     {
+        // only body 0 is simulated on the client side for now
+
+        if (id!=0)
+            return;
+
         client->synchronize(t, state, input);
+
+        if (!remote)
+            return;
+
         proxy->synchronize(t, state, input);
+
+        // the proxy now predicts from this state, mirror it on the server side
+
+        if (proxy->mode==Proxy::DeadReckoning)
+        {
+            mirror.reset(t, state, input);
+            remotePending = 0;
+        }
     }
 
 private:
@@ -121,27 +319,37 @@ private:
 
     struct InputEvent : public Event
     {
-        unsigned int time;
-        Cube::Input input;
-        std::vector<Move> importantMoves;
+        InputWindow window;
         void execute(Connection &connection)
         {
-            connection.input(time, input, importantMoves);
+            connection.input(window);
         }
     };
 
-    struct SyncEvent : public Event
+    struct BodyUpdate
     {
-        unsigned int time;
+        int id;
         Cube::State state;
         Cube::Input input;
+        bool remote;                            ///< forward to the proxy as well as the client
+    };
+
+    struct SyncEvent : public Event
+    {
+        unsigned int time;
+        unsigned int ack;
+        std::vector<BodyUpdate> updates;
         void execute(Connection &connection)
         {
-            connection.synchronize(time, state, input);
+            trace.instant("sync delivered", Profiler::Simulation, "bodies", (double) updates.size());
+
+            connection.acknowledge(ack);
+            for (unsigned int i=0; i<updates.size(); i++)
+                connection.synchronize(time, updates[i].id, updates[i].state, updates[i].input, updates[i].remote);
         }
     };
 
-    typedef std::queue<Event*> EventQueue;
+    typedef RingBuffer<Event*> EventQueue;
 
     EventQueue clientToServer;
     EventQueue serverToClient;
@@ -152,23 +360,25 @@ private:
     {
         assert(event);
         event->deliveryTime = time + (unsigned int) (latency/timestep);
-        queue.push(event);
+        queue.add(event);
     }
 
     /// process event queue and execute events ready for delivery
 
     void process(EventQueue &queue)
     {
-        while (queue.size())
+        while (!queue.empty())
         {
-            Event *event = queue.front();
+            Event *event = queue.oldest();
 
             if (event->deliveryTime<=time)
             {
                 if (!chance(packetLoss))
                     event->execute(*this);
+                else
+                    trace.instant("packet lost", Profiler::Simulation);
 
-                queue.pop();
+                queue.remove();
 
                 delete event;
             }
@@ -189,6 +399,17 @@ private:
     Server *server;
     Proxy *proxy;
 
+    Relevancy::Client observer;                 ///< relevancy state for the client
+    std::vector<Relevancy::Body> bodies;        ///< server bodies considered for sending
+    std::vector<int> selected;                  ///< ids of bodies selected for sending
+    std::vector<unsigned int> lastSent;         ///< time each body was last sent, indexed by body id
+    DeadReckoning mirror;                       ///< server side copy of the proxy dead reckoning prediction
+    unsigned int remotePending;                 ///< delivery time of the dead reckoning update in flight, zero if none
+
+    unsigned int snapshotTime;                  ///< server time of the last snapshot
+    unsigned int ack;                           ///< client side copy of the most recent input ack from the server
+    Statistics statistics;
+
     FILE *logfile;
 
     unsigned int time;
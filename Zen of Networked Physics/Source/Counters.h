@@ -0,0 +1,198 @@
+/// Hardware performance counters.
+/// Counts cycles, instructions, cache misses and branch misses in user space
+/// for the calling thread with Linux perf_event_open, to tell whether a hot
+/// function is bound by computation, memory or branching. Counters are often
+/// unavailable, in containers and virtual machines, when perf_event_paranoid
+/// forbids them, and on every other platform. Any counter that cannot be opened
+/// simply reads as unavailable, so callers report what they can and carry on.
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+class Counters
+{
+public:
+
+    /// Counted events.
+
+    enum Counter
+    {
+        Cycles,
+        Instructions,
+        CacheMisses,
+        BranchMisses,
+        CounterCount
+    };
+
+    /// Open the counters for the calling thread, stopped and at zero.
+
+    Counters()
+    {
+        error = 0;
+
+        for (int i=0; i<CounterCount; i++)
+            descriptors[i] = -1;
+
+#ifdef __linux__
+
+        static const unsigned long long events[CounterCount] =
+        {
+            PERF_COUNT_HW_CPU_CYCLES,
+            PERF_COUNT_HW_INSTRUCTIONS,
+            PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_BRANCH_MISSES
+        };
+
+        for (int i=0; i<CounterCount; i++)
+        {
+            perf_event_attr attributes;
+            memset(&attributes, 0, sizeof(attributes));
+
+            attributes.size = sizeof(attributes);
+            attributes.type = PERF_TYPE_HARDWARE;
+            attributes.config = events[i];
+            attributes.disabled = 1;
+            attributes.exclude_kernel = 1;
+            attributes.exclude_hv = 1;
+            attributes.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+            descriptors[i] = (int) syscall(SYS_perf_event_open, &attributes, 0, -1, -1, 0);
+
+            if (descriptors[i]<0 && !error)
+                error = errno;
+        }
+
+#endif
+    }
+
+    ~Counters()
+    {
+#ifdef __linux__
+        for (int i=0; i<CounterCount; i++)
+        {
+            if (descriptors[i]>=0)
+                ::close(descriptors[i]);
+        }
+#endif
+    }
+
+    /// Name of a counter.
+
+    static const char* name(Counter counter)
+    {
+        static const char *names[CounterCount] = { "cycles", "instructions", "cache misses", "branch misses" };
+        return names[counter];
+    }
+
+    /// True if a counter could be opened.
+
+    bool available(Counter counter) const
+    {
+        return descriptors[counter]>=0;
+    }
+
+    /// True if any counter could be opened.
+
+    bool available() const
+    {
+        for (int i=0; i<CounterCount; i++)
+        {
+            if (descriptors[i]>=0)
+                return true;
+        }
+
+        return false;
+    }
+
+    /// Why the first counter that failed to open could not be opened, null if all opened.
+
+    const char* reason() const
+    {
+#ifdef __linux__
+        return error ? strerror(error) : 0;
+#else
+        return "not supported on this platform";
+#endif
+    }
+
+    /// Set all counts to zero.
+
+    void reset()
+    {
+#ifdef __linux__
+        for (int i=0; i<CounterCount; i++)
+        {
+            if (descriptors[i]>=0)
+                ioctl(descriptors[i], PERF_EVENT_IOC_RESET, 0);
+        }
+#endif
+    }
+
+    /// Start counting, counts add to those since the last reset.
+
+    void start()
+    {
+#ifdef __linux__
+        for (int i=0; i<CounterCount; i++)
+        {
+            if (descriptors[i]>=0)
+                ioctl(descriptors[i], PERF_EVENT_IOC_ENABLE, 0);
+        }
+#endif
+    }
+
+    /// Stop counting.
+
+    void stop()
+    {
+#ifdef __linux__
+        for (int i=0; i<CounterCount; i++)
+        {
+            if (descriptors[i]>=0)
+                ioctl(descriptors[i], PERF_EVENT_IOC_DISABLE, 0);
+        }
+#endif
+    }
+
+    /// Read the count since the last reset.
+    /// When more counters are open than the hardware has, the kernel shares the
+    /// hardware between them and the count is scaled up to the full time counted.
+    /// @returns false if the counter is unavailable.
+
+    bool read(Counter counter, double &value) const
+    {
+        value = 0.0;
+
+#ifdef __linux__
+        if (descriptors[counter]<0)
+            return false;
+
+        unsigned long long data[3];     // value, time enabled, time running
+
+        if (::read(descriptors[counter], data, sizeof(data))!=sizeof(data))
+            return false;
+
+        value = (double) data[0];
+
+        if (data[2]>0 && data[2]<data[1])
+            value *= (double) data[1] / (double) data[2];
+
+        return true;
+#else
+        return false;
+#endif
+    }
+
+private:
+
+    Counters(const Counters &other);
+    Counters& operator=(const Counters &other);
+
+    int descriptors[CounterCount];      ///< perf event file descriptors, -1 if unavailable.
+    int error;                          ///< errno from the first counter that failed to open.
+};
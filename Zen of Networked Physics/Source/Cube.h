@@ -14,6 +14,18 @@ public:
 
     float r,g,b,a;
 
+    /// Integration method used to advance the physics state each update.
+
+    enum Integrator
+    {
+        RK4,                            ///< classic fixed step fourth order runge kutta.
+        DormandPrince                   ///< adaptive dormand-prince 5(4) with embedded error estimation.
+    };
+
+    Integrator integrator;              ///< integration method used by Cube::update.
+    float tolerance;                    ///< maximum local error per substep for the adaptive integrator.
+    int substeps;                       ///< number of substeps taken during the last update.
+
     /// Input data.
 
     struct Input
@@ -23,6 +35,26 @@ public:
         bool forward;
         bool back;
         bool jump;
+
+        enum { Bits = 5 };              ///< number of bits in packed input.
+
+        /// pack input into the low bits of an integer.
+
+        unsigned int pack() const
+        {
+            return (left ? 1 : 0) | (right ? 2 : 0) | (forward ? 4 : 0) | (back ? 8 : 0) | (jump ? 16 : 0);
+        }
+
+        /// unpack input from the low bits of an integer.
+
+        void unpack(unsigned int bits)
+        {
+            left = (bits & 1) != 0;
+            right = (bits & 2) != 0;
+            forward = (bits & 4) != 0;
+            back = (bits & 8) != 0;
+            jump = (bits & 16) != 0;
+        }
     };
 
     /// Physics state.
@@ -116,6 +148,15 @@ public:
 		previous = current;
 
         r = g = b = a = 1;
+
+        #ifdef ADAPTIVE_INTEGRATION
+        integrator = DormandPrince;
+        #else
+        integrator = RK4;
+        #endif
+
+        tolerance = 0.001f;
+        substeps = 0;
 	}
 
     /// Update physics state.
@@ -125,142 +166,20 @@ public:
 
     void update(const Input &input, const std::vector<Plane> &planes, float dt)
     {
-        previous = current;
-        integrate(input, planes, current, dt);
-    }
+        Profiler::Timer timer(profiler, Profiler::CubeUpdate);
 
-    /// Smooth physics state towards target.
-
-    void smooth(const State &target, float tightness)
-    {
         previous = current;
-        current = target;
-        current.position = previous.position + (target.position-previous.position) * tightness;
-        current.orientation = slerp(previous.orientation, target.orientation, tightness);
-        current.recalculate();
-    }
-
-    /// Render cube at interpolated state.
-    /// Calculates interpolated state then renders cube at the interpolated 
-	/// position and orientation using OpenGL.
-	/// @param alpha interpolation alpha in [0,1]
-
-    void render(const Vector &light, float alpha = 1.0f)
-	{	
-		glPushMatrix();
-
-		State state = interpolate(previous, current, alpha);
-		
-		glTranslatef(state.position.x, state.position.y, state.position.z); 
-		
-		float angle;
-		Mathematics::Vector axis;		
-		state.orientation.angleAxis(angle, axis);
-		glRotatef(angle/Mathematics::pi*180, axis.x, axis.y, axis.z);
-		
-        // render cube
-
-        GLfloat color[] = { r, g, b, a };
 
-		glMaterialfv(GL_FRONT, GL_AMBIENT, color);
-		glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
-		
-		glEnable(GL_LIGHTING);
-		
-        if (a!=1.0f)
+        if (integrator==DormandPrince)
         {
-            glEnable(GL_BLEND);
-            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            substeps = integrateAdaptive(input, planes, current, dt, tolerance);
         }
-
-        glDepthFunc(GL_ALWAYS);
-
-        const float s = state.size * 0.5f;
-
-        glBegin(GL_QUADS);
-		
-			glNormal3f(0,0,+1);
-			glVertex3f(-s,-s,+s);
-			glVertex3f(+s,-s,+s);
-			glVertex3f(+s,+s,+s);
-			glVertex3f(-s,+s,+s);
-
-			glNormal3f(0,0,-1);
-			glVertex3f(-s,-s,-s);
-			glVertex3f(-s,+s,-s);
-			glVertex3f(+s,+s,-s);
-			glVertex3f(+s,-s,-s);
-			
-			glNormal3f(0,+1,0);
-			glVertex3f(-s,+s,-s);
-			glVertex3f(-s,+s,+s);
-			glVertex3f(+s,+s,+s);
-			glVertex3f(+s,+s,-s);
-			
-			glNormal3f(0,-1,0);
-			glVertex3f(-s,-s,-s);
-			glVertex3f(+s,-s,-s);
-			glVertex3f(+s,-s,+s);
-			glVertex3f(-s,-s,+s);
-
-			glNormal3f(+1,0,0);
-			glVertex3f(+s,-s,-s);
-			glVertex3f(+s,+s,-s);
-			glVertex3f(+s,+s,+s);
-			glVertex3f(+s,-s,+s);
-			
-			glNormal3f(-1,0,0);
-			glVertex3f(-s,-s,-s);
-			glVertex3f(-s,-s,+s);
-			glVertex3f(-s,+s,+s);
-			glVertex3f(-s,+s,-s);
-			
-		glEnd();
-
-        glDepthFunc(GL_LEQUAL);
-
-        glDisable(GL_BLEND);
-		glDisable(GL_LIGHTING);
-
-        // render shadow volume
-
-        if (a==1.0f)
+        else
         {
-            // enter state for rendering shadow volumes to stencil
-
-            glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
-            glDepthMask(GL_FALSE);
-            
-            glEnable(GL_STENCIL_TEST);
-
-            Vector bodySpaceLight = state.worldToBody * light;
-
-            // render front faces
-
-            glStencilFunc(GL_ALWAYS, 0x0, 0xff);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
-
-            renderShadowVolume(state, bodySpaceLight);
-
-            // render shadow volume back faces
-
-            glCullFace(GL_FRONT);
-            glStencilFunc(GL_ALWAYS, 0x0, 0xff);
-            glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
-            
-            renderShadowVolume(state, bodySpaceLight);
-
-            // restore normal rendering state
-
-            glCullFace(GL_BACK);
-            glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
-            glDepthMask(GL_TRUE);
-
-            glDisable(GL_STENCIL_TEST);
+            integrate(input, planes, current, dt);
+            substeps = 1;
         }
-
-		glPopMatrix();
-	}
+    }
 
     void snap(const State &state)
     {
@@ -268,94 +187,30 @@ public:
         previous = state;
     }
 
+    /// Set physics state without integrating.
+    /// The previous state is kept so rendering still interpolates smoothly.
+
+    void set(const State &state)
+    {
+        previous = current;
+        current = state;
+    }
+
     const State &state() const
     {
         return current;
     }
-	
-private:
-
-    /// render shadow volume
 
-    static void renderShadowVolume(const State &state, const Vector &light)
+    const State &previousState() const
     {
-        glBegin(GL_QUADS);
-
-        const float s = state.size * 0.5f;
-
-        silhouette(light, Vector(-s,+s,-s), Vector(+s,+s,-s));
-        silhouette(light, Vector(+s,+s,-s), Vector(+s,+s,+s));
-        silhouette(light, Vector(+s,+s,+s), Vector(-s,+s,+s));
-        silhouette(light, Vector(-s,+s,+s), Vector(-s,+s,-s));
-
-        silhouette(light, Vector(-s,-s,-s), Vector(+s,-s,-s));
-        silhouette(light, Vector(+s,-s,-s), Vector(+s,-s,+s));
-        silhouette(light, Vector(+s,-s,+s), Vector(-s,-s,+s));
-        silhouette(light, Vector(-s,-s,+s), Vector(-s,-s,-s));
-
-        silhouette(light, Vector(-s,+s,-s), Vector(-s,-s,-s));
-        silhouette(light, Vector(+s,+s,-s), Vector(+s,-s,-s));
-        silhouette(light, Vector(+s,+s,+s), Vector(+s,-s,+s));
-        silhouette(light, Vector(-s,+s,+s), Vector(-s,-s,+s));
-
-        glEnd();
+        return previous;
     }
 
-    /// test and render edge a-b if its a silhouette edge relative to light
+    /// Physics state interpolated between the previous and current state.
 
-    static void silhouette(const Vector &light, Vector a, Vector b)
+    State interpolated(float alpha) const
     {
-        // determine edge normals
-
-        Vector midpoint = (a + b) * 0.5f;
-        
-        Vector leftNormal;
-
-        if (midpoint.x!=0)
-            leftNormal = Vector(midpoint.x, 0, 0);
-        else
-            leftNormal = Vector(0, midpoint.y, 0);
-
-        Vector rightNormal = midpoint - leftNormal;
-
-        // check if silhouette edge
-
-        const Vector differenceA = a - light;
-
-        const float leftDot = leftNormal.dot(differenceA);
-        const float rightDot = rightNormal.dot(differenceA);
-
-        if ((leftDot<0 && rightDot>0) || (leftDot>0 && rightDot<0))
-        {
-            // extrude quad
-
-            const Vector differenceB = b - light;
-
-            Vector _a = a + differenceA * 100;
-            Vector _b = b + differenceB * 100;
-
-            // ensure correct winding order for silhouette edge
-
-            const Vector cross = (b - a).cross(differenceA);
-            
-            if (cross.dot(a)<0)
-            {
-                Vector t = a;
-                a = b;
-                b = t;
-
-                t = _a;
-                _a = _b;
-                _b = t;
-            }
-
-            // render extruded quad
-
-            glVertex3f(a.x, a.y, a.z); 
-            glVertex3f(b.x, b.y, b.z);
-            glVertex3f(_b.x, _b.y, _b.z);
-            glVertex3f(_a.x, _a.y, _a.z); 
-        }
+        return interpolate(previous, current, alpha);
     }
 
     /// Interpolate between two physics states.
@@ -371,6 +226,16 @@ private:
 		return state;
 	}
 
+    /// Calculate the force and torque acting on a physics state.
+    /// Used to predict motion without integrating, see DeadReckoning.
+
+	static void calculateForces(const Input &input, const std::vector<Plane> &planes, const State &state, Vector &force, Vector &torque)
+	{
+		forces(input, planes, state, force, torque);
+	}
+
+private:
+
 	State previous;		///< previous physics state.
     State current;		///< current physics state.
 
@@ -414,11 +279,7 @@ private:
 
 	static Derivative evaluate(const Input &input, const std::vector<Plane> &planes, State state, float dt, const Derivative &derivative)
 	{
-		state.position += derivative.velocity * dt;
-		state.momentum += derivative.force * dt;
-		state.orientation += derivative.spin * dt;
-		state.angularMomentum += derivative.torque * dt;
-		state.recalculate();
+		advance(state, dt, derivative);
 		
 		Derivative output;
 		output.velocity = state.velocity;
@@ -447,6 +308,149 @@ private:
 		state.recalculate();
 	}	
 
+    /// Advance primary state by dt seconds along the specified derivative then recalculate secondary state.
+
+    static void advance(State &state, float dt, const Derivative &derivative)
+    {
+		state.position += derivative.velocity * dt;
+		state.momentum += derivative.force * dt;
+		state.orientation += derivative.spin * dt;
+		state.angularMomentum += derivative.torque * dt;
+		state.recalculate();
+    }
+
+    /// Calculate the weighted sum of a set of derivatives.
+    /// Used to build the intermediate stages of the adaptive integrator.
+
+    static Derivative combine(const Derivative k[], const float weights[], int count)
+    {
+        Derivative output;
+        output.velocity.zero();
+        output.force.zero();
+        output.spin.zero();
+        output.torque.zero();
+
+        for (int i=0; i<count; i++)
+        {
+            if (weights[i]==0)
+                continue;
+
+            output.velocity += k[i].velocity * weights[i];
+            output.force += k[i].force * weights[i];
+            output.spin += k[i].spin * weights[i];
+            output.torque += k[i].torque * weights[i];
+        }
+
+        return output;
+    }
+
+    /// Take a single dormand-prince 5(4) step of h seconds.
+    /// On entry k[0] must hold the derivative at the start of the step, on exit k[6]
+    /// holds the derivative at the end of the step so it can be reused as k[0] of the
+    /// next step (first same as last). The difference between the embedded fourth and
+    /// fifth order solutions gives an estimate of the local error which is returned
+    /// as the largest error in position (meters), orientation, velocity (meters per
+    /// second) and angular velocity.
+
+    static float step(const Input &input, const std::vector<Plane> &planes, const State &state, float h, Derivative k[7], State &output)
+    {
+        static const float a[6][6] = 
+        {
+            { 1.0f/5.0f },
+            { 3.0f/40.0f, 9.0f/40.0f },
+            { 44.0f/45.0f, -56.0f/15.0f, 32.0f/9.0f },
+            { 19372.0f/6561.0f, -25360.0f/2187.0f, 64448.0f/6561.0f, -212.0f/729.0f },
+            { 9017.0f/3168.0f, -355.0f/33.0f, 46732.0f/5247.0f, 49.0f/176.0f, -5103.0f/18656.0f },
+            { 35.0f/384.0f, 0.0f, 500.0f/1113.0f, 125.0f/192.0f, -2187.0f/6784.0f, 11.0f/84.0f }
+        };
+
+        static const float e[7] = 
+        { 
+            71.0f/57600.0f, 0.0f, -71.0f/16695.0f, 71.0f/1920.0f, -17253.0f/339200.0f, 22.0f/525.0f, -1.0f/40.0f 
+        };
+
+        for (int i=1; i<6; i++)
+            k[i] = evaluate(input, planes, state, h, combine(k, a[i-1], i));
+
+        output = state;
+        advance(output, h, combine(k, a[5], 6));
+
+        k[6] = evaluate(input, planes, output);
+
+        const Derivative error = combine(k, e, 7);
+
+        const float positionError = (error.velocity * h).length();
+        const float orientationError = (error.spin * h).length();
+        const float velocityError = (error.force * h).length() * state.inverseMass;
+        const float angularVelocityError = (error.torque * h).length() * state.inverseInertiaTensor;
+
+        return maximum(maximum(positionError, orientationError), maximum(velocityError, angularVelocityError));
+    }
+
+    /// Integrate physics state forward by dt seconds using adaptive substeps.
+    ///
+    /// Each substep is a dormand-prince 5(4) step with embedded error estimation.
+    /// Steps with error above tolerance are rejected and retried with a smaller
+    /// step size, accepted steps grow the step size for the next substep. Quiet
+    /// bodies cover the whole update in a single step while bodies in stiff contact
+    /// subdivide as required.
+    ///
+    /// The step size always restarts at dt so the result depends only on the state
+    /// and input at the start of the update. This keeps the simulation deterministic
+    /// which is required for client side correction replays to match the server.
+    ///
+    /// @returns the number of accepted substeps.
+
+    static int integrateAdaptive(const Input &input, const std::vector<Plane> &planes, State &state, float dt, float tolerance)
+    {
+        const int maximumSubsteps = 64;
+        const float minimumStep = dt / maximumSubsteps;
+
+        Derivative k[7];
+        k[0] = evaluate(input, planes, state);
+
+        float remaining = dt;
+        float h = dt;
+        int count = 0;
+
+        while (remaining>0)
+        {
+            // take the remainder of the update if we would otherwise leave a sliver
+
+            const bool last = h>=remaining*0.999f;
+            if (last)
+                h = remaining;
+
+            State next;
+            const float error = step(input, planes, state, h, k, next);
+
+            if (error<=tolerance || h<=minimumStep)
+            {
+                state = next;
+                k[0] = k[6];
+                count++;
+
+                if (last)
+                    break;
+
+                remaining -= h;
+
+                const float scale = error>0 ? 0.9f * (float) pow(tolerance/error, 0.2f) : 5.0f;
+                h *= minimum(maximum(scale, 0.2f), 5.0f);
+            }
+            else
+            {
+                const float scale = 0.9f * (float) pow(tolerance/error, 0.25f);
+                h *= maximum(scale, 0.2f);
+            }
+
+            if (h<minimumStep)
+                h = minimumStep;
+        }
+
+        return count;
+    }
+
     /// Calculate force and torque for physics state at time t.
     /// Due to the way that the RK4 integrator works we need to calculate
     /// force implicitly from state rather than explictly applying forces
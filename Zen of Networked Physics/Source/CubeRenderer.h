@@ -0,0 +1,443 @@
+/// Cube renderer.
+/// Collects all cubes to be drawn in a frame then draws them together.
+/// Cube vertices are transformed on the CPU into one interleaved normal and
+/// position array per material, so each distinct cube color costs a single
+/// draw call no matter how many cubes share it. Shadow volumes for opaque
+/// cubes are rendered into the stencil buffer after all cubes are drawn:
+/// silhouette edges are found once per cube, extruded into a single shared
+/// array, and the whole array is drawn in two stencil passes.
+/// When given a view frustum, cubes outside it are culled by bounding sphere
+/// and distant cubes skip their shadow volumes, so the cost of a frame follows
+/// the number of visible cubes rather than the size of the world.
+/// Cubes are drawn without depth testing, so opaque batches are drawn first
+/// and translucent batches after them, back to front when the eye is known.
+
+class CubeRenderer
+{
+public:
+
+    /// Renderer statistics for the last frame.
+
+    struct Statistics
+    {
+        int cubes;                      ///< cubes drawn.
+        int culled;                     ///< cubes outside the view frustum, not drawn.
+        int shadows;                    ///< shadow volumes rendered.
+        int shadowsSkipped;             ///< shadow volumes skipped, too far away or not reaching the view.
+        int silhouetteEdges;            ///< silhouette edges extruded for all shadow volumes.
+        int batches;                    ///< distinct materials.
+        int drawCalls;                  ///< OpenGL draw calls issued.
+        int vertices;                   ///< vertices submitted.
+    };
+
+    bool shadows;                       ///< render shadow volumes for opaque cubes.
+    float shadowDistance;               ///< cubes further than this from the eye cast no shadow when culling.
+    float shadowLength;                 ///< how far a shadow is assumed to reach when deciding if a culled cube's shadow is visible.
+
+    CubeRenderer()
+    {
+        shadows = true;
+        shadowDistance = 25.0f;
+        shadowLength = 10.0f;
+        used = 0;
+        frustum = 0;
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// Start collecting cubes for a new frame.
+
+    void begin()
+    {
+        for (int i=0; i<used; i++)
+            batches[i].vertices.clear();
+
+        used = 0;
+        frustum = 0;
+        casters.clear();
+        hidden.clear();
+
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// Start collecting cubes for a new frame, culling them against a view frustum.
+    /// The frustum must stay valid until render is called.
+
+    void begin(const Frustum &frustum)
+    {
+        begin();
+        this->frustum = &frustum;
+    }
+
+    /// Add a cube at its interpolated state using its own color.
+
+    void add(const Cube &cube, float alpha)
+    {
+        add(cube.interpolated(alpha), cube.r, cube.g, cube.b, cube.a);
+    }
+
+    /// Add a cube at a physics state with a color.
+    /// Opaque cubes also cast shadows.
+
+    void add(const Cube::State &state, float r, float g, float b, float a)
+    {
+        bool casts = a==1.0f && shadows;
+
+        if (frustum)
+        {
+            if (casts && (state.position - frustum->eye).lengthSquared() > shadowDistance * shadowDistance)
+            {
+                statistics.shadowsSkipped++;
+                casts = false;
+            }
+
+            if (!frustum->visible(state.position, state.size * 0.8660254f))
+            {
+                // the shadow may still fall in view, decided once the light is known
+
+                if (casts)
+                    hidden.push_back(state);
+
+                statistics.culled++;
+                return;
+            }
+        }
+
+        Batch &batch = find(r, g, b, a);
+
+        if (frustum && a!=1.0f)
+        {
+            const float depth = (state.position - frustum->eye).lengthSquared();
+
+            if (depth>batch.depth)
+                batch.depth = depth;
+        }
+
+        // rotate normals and transform corners into world space
+
+        const Matrix &m = state.bodyToWorld;
+        const float s = state.size * 0.5f;
+
+        const unsigned int first = (unsigned int) batch.vertices.size();
+
+        batch.vertices.resize(first + 24);
+
+        Vertex *vertex = &batch.vertices[first];
+
+        for (int i=0; i<24; i++)
+        {
+            const float *n = unitCube[i];
+            const float x = n[3] * s;
+            const float y = n[4] * s;
+            const float z = n[5] * s;
+
+            vertex->nx = m.m11 * n[0] + m.m12 * n[1] + m.m13 * n[2];
+            vertex->ny = m.m21 * n[0] + m.m22 * n[1] + m.m23 * n[2];
+            vertex->nz = m.m31 * n[0] + m.m32 * n[1] + m.m33 * n[2];
+
+            vertex->x = m.m11 * x + m.m12 * y + m.m13 * z + state.position.x;
+            vertex->y = m.m21 * x + m.m22 * y + m.m23 * z + state.position.y;
+            vertex->z = m.m31 * x + m.m32 * y + m.m33 * z + state.position.z;
+
+            vertex++;
+        }
+
+        if (casts)
+            casters.push_back(state);
+    }
+
+    /// Draw all cubes added this frame then render their shadow volumes.
+
+    void render(const Vector &light)
+    {
+        glEnable(GL_LIGHTING);
+        glDepthFunc(GL_ALWAYS);
+
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+
+        sort();
+
+        for (unsigned int i=0; i<order.size(); i++)
+        {
+            const Batch &batch = batches[order[i]];
+
+            if (batch.vertices.empty())
+                continue;
+
+            GLfloat color[] = { batch.r, batch.g, batch.b, batch.a };
+
+            glMaterialfv(GL_FRONT, GL_AMBIENT, color);
+            glMaterialfv(GL_FRONT, GL_DIFFUSE, color);
+
+            if (batch.a!=1.0f)
+            {
+                glEnable(GL_BLEND);
+                glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            }
+
+            glInterleavedArrays(GL_N3F_V3F, 0, &batch.vertices[0]);
+            glDrawArrays(GL_QUADS, 0, (GLsizei) batch.vertices.size());
+
+            glDisable(GL_BLEND);
+
+            statistics.batches++;
+            statistics.drawCalls++;
+            statistics.vertices += (int) batch.vertices.size();
+            statistics.cubes += (int) batch.vertices.size() / 24;
+        }
+
+        glPopClientAttrib();
+
+        glDepthFunc(GL_LEQUAL);
+        glDisable(GL_LIGHTING);
+
+        // culled cubes cast shadows only if the shadow swept away from the light may reach the view
+
+        for (unsigned int i=0; i<hidden.size(); i++)
+        {
+            const Cube::State &state = hidden[i];
+
+            const Vector end = state.position + (state.position - light).unit() * shadowLength;
+
+            if (frustum->visible(state.position, end, state.size * 0.8660254f))
+                casters.push_back(state);
+            else
+                statistics.shadowsSkipped++;
+        }
+
+        // shadow volumes
+
+        if (casters.empty())
+            return;
+
+        volumes.clear();
+
+        for (unsigned int i=0; i<casters.size(); i++)
+            extrude(casters[i], light);
+
+        statistics.shadows = (int) casters.size();
+        statistics.silhouetteEdges = (int) volumes.size() / 12;
+
+        if (volumes.empty())
+            return;
+
+        // enter state for rendering shadow volumes to stencil
+
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glDepthMask(GL_FALSE);
+
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 0x0, 0xff);
+
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, &volumes[0]);
+
+        // render front faces
+
+        glStencilOp(GL_KEEP, GL_KEEP, GL_INCR);
+        glDrawArrays(GL_QUADS, 0, (GLsizei) volumes.size() / 3);
+
+        // render back faces
+
+        glCullFace(GL_FRONT);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_DECR);
+        glDrawArrays(GL_QUADS, 0, (GLsizei) volumes.size() / 3);
+
+        glPopClientAttrib();
+
+        statistics.drawCalls += 2;
+
+        // restore normal rendering state
+
+        glCullFace(GL_BACK);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDepthMask(GL_TRUE);
+
+        glDisable(GL_STENCIL_TEST);
+    }
+
+    /// Statistics for the last frame rendered.
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+private:
+
+    /// Interleaved vertex, matches GL_N3F_V3F.
+
+    struct Vertex
+    {
+        float nx, ny, nz;
+        float x, y, z;
+    };
+
+    /// Find the silhouette edges of a cube relative to the light and add the
+    /// extruded shadow volume quads, in world space, to the shared volume array.
+    /// The silhouette test is done in body space where the face normals are constant.
+
+    void extrude(const Cube::State &state, const Vector &light)
+    {
+        const Vector bodySpaceLight = state.worldToBody * light;
+
+        const float s = state.size * 0.5f;
+
+        for (int i=0; i<12; i++)
+        {
+            const float *edge = silhouetteEdges[i];
+
+            Vector a(edge[0]*s, edge[1]*s, edge[2]*s);
+            Vector b(edge[3]*s, edge[4]*s, edge[5]*s);
+
+            const Vector differenceA = a - bodySpaceLight;
+
+            const float leftDot = edge[6] * differenceA.x + edge[7] * differenceA.y + edge[8] * differenceA.z;
+            const float rightDot = edge[9] * differenceA.x + edge[10] * differenceA.y + edge[11] * differenceA.z;
+
+            if (!((leftDot<0 && rightDot>0) || (leftDot>0 && rightDot<0)))
+                continue;
+
+            // extrude quad away from the light
+
+            const Vector differenceB = b - bodySpaceLight;
+
+            Vector _a = a + differenceA * 100;
+            Vector _b = b + differenceB * 100;
+
+            // ensure correct winding order for silhouette edge
+
+            if ((b - a).cross(differenceA).dot(a)<0)
+            {
+                Vector t = a;
+                a = b;
+                b = t;
+
+                t = _a;
+                _a = _b;
+                _b = t;
+            }
+
+            vertex(state.bodyToWorld * a);
+            vertex(state.bodyToWorld * b);
+            vertex(state.bodyToWorld * _b);
+            vertex(state.bodyToWorld * _a);
+        }
+    }
+
+    void vertex(const Vector &v)
+    {
+        volumes.push_back(v.x);
+        volumes.push_back(v.y);
+        volumes.push_back(v.z);
+    }
+
+    /// Cubes sharing a material.
+
+    struct Batch
+    {
+        float r, g, b, a;
+        float depth;                    ///< squared distance from the eye to the farthest translucent cube.
+        std::vector<Vertex> vertices;
+    };
+
+    /// Orders translucent batches farthest first.
+
+    struct FartherFirst
+    {
+        const std::vector<Batch> &batches;
+
+        FartherFirst(const std::vector<Batch> &batches) : batches(batches) {}
+
+        bool operator()(int a, int b) const
+        {
+            return batches[a].depth > batches[b].depth;
+        }
+    };
+
+    /// Order the batches for drawing: opaque batches in the order their materials
+    /// were first added, then translucent batches back to front.
+
+    void sort()
+    {
+        order.clear();
+
+        for (int i=0; i<used; i++)
+        {
+            if (batches[i].a==1.0f)
+                order.push_back(i);
+        }
+
+        const unsigned int opaque = (unsigned int) order.size();
+
+        for (int i=0; i<used; i++)
+        {
+            if (batches[i].a!=1.0f)
+                order.push_back(i);
+        }
+
+        std::stable_sort(order.begin() + opaque, order.end(), FartherFirst(batches));
+    }
+
+    /// Find the batch for a material, adding a new batch if none matches.
+
+    Batch& find(float r, float g, float b, float a)
+    {
+        for (int i=0; i<used; i++)
+        {
+            Batch &batch = batches[i];
+            if (batch.r==r && batch.g==g && batch.b==b && batch.a==a)
+                return batch;
+        }
+
+        if (used==(int)batches.size())
+            batches.resize(used+1);
+
+        Batch &batch = batches[used++];
+        batch.r = r;
+        batch.g = g;
+        batch.b = b;
+        batch.a = a;
+        batch.depth = 0.0f;
+        return batch;
+    }
+
+    static const float unitCube[24][6];     ///< unit cube quads as normal and corner sign.
+    static const float silhouetteEdges[12][12];     ///< unit cube edges as corner signs followed by the normals of the two faces sharing the edge.
+
+    std::vector<Batch> batches;         ///< batches, vertex storage is kept between frames.
+    int used;                           ///< batches in use this frame.
+    std::vector<int> order;             ///< indices of the batches in use in drawing order.
+    std::vector<Cube::State> casters;   ///< opaque cube states casting shadows this frame.
+    std::vector<Cube::State> hidden;    ///< culled cubes whose shadow may still be visible.
+    const Frustum *frustum;             ///< frustum to cull against this frame, null for no culling.
+    std::vector<float> volumes;         ///< shadow volume quad vertices for all casters this frame.
+
+    Statistics statistics;
+};
+
+const float CubeRenderer::unitCube[24][6] =
+{
+    { 0,0,+1, -1,-1,+1 }, { 0,0,+1, +1,-1,+1 }, { 0,0,+1, +1,+1,+1 }, { 0,0,+1, -1,+1,+1 },
+    { 0,0,-1, -1,-1,-1 }, { 0,0,-1, -1,+1,-1 }, { 0,0,-1, +1,+1,-1 }, { 0,0,-1, +1,-1,-1 },
+    { 0,+1,0, -1,+1,-1 }, { 0,+1,0, -1,+1,+1 }, { 0,+1,0, +1,+1,+1 }, { 0,+1,0, +1,+1,-1 },
+    { 0,-1,0, -1,-1,-1 }, { 0,-1,0, +1,-1,-1 }, { 0,-1,0, +1,-1,+1 }, { 0,-1,0, -1,-1,+1 },
+    { +1,0,0, +1,-1,-1 }, { +1,0,0, +1,+1,-1 }, { +1,0,0, +1,+1,+1 }, { +1,0,0, +1,-1,+1 },
+    { -1,0,0, -1,-1,-1 }, { -1,0,0, -1,-1,+1 }, { -1,0,0, -1,+1,+1 }, { -1,0,0, -1,+1,-1 },
+};
+
+const float CubeRenderer::silhouetteEdges[12][12] =
+{
+    { -1,+1,-1, +1,+1,-1, 0,+1,0, 0,0,-1 },
+    { +1,+1,-1, +1,+1,+1, +1,0,0, 0,+1,0 },
+    { +1,+1,+1, -1,+1,+1, 0,+1,0, 0,0,+1 },
+    { -1,+1,+1, -1,+1,-1, -1,0,0, 0,+1,0 },
+    { -1,-1,-1, +1,-1,-1, 0,-1,0, 0,0,-1 },
+    { +1,-1,-1, +1,-1,+1, +1,0,0, 0,-1,0 },
+    { +1,-1,+1, -1,-1,+1, 0,-1,0, 0,0,+1 },
+    { -1,-1,+1, -1,-1,-1, -1,0,0, 0,-1,0 },
+    { -1,+1,-1, -1,-1,-1, -1,0,0, 0,0,-1 },
+    { +1,+1,-1, +1,-1,-1, +1,0,0, 0,0,-1 },
+    { +1,+1,+1, +1,-1,+1, +1,0,0, 0,0,+1 },
+    { -1,+1,+1, -1,-1,+1, -1,0,0, 0,0,+1 },
+};
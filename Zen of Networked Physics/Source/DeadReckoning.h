@@ -0,0 +1,272 @@
+/// Dead reckoning.
+/// Predicts the motion of a remote body forward from the last state received
+/// without integrating physics while the body is in free flight. The force and
+/// torque acting on the body are evaluated once at the reference state and
+/// assumed constant, giving a closed form ballistic prediction for any time.
+/// When the body is predicted to touch a collision plane the constant force
+/// assumption breaks down, so the prediction falls back to full Cube physics
+/// until the body is clear again and then rebases the ballistic prediction.
+/// A body with no input sitting still on a plane is simply held at rest, so
+/// the common case of a cube lying on the floor costs nothing to predict.
+///
+/// The server runs an identical predictor for each remote viewer so it knows
+/// exactly what the viewer is showing, and only sends an update when the
+/// prediction error exceeds the error budget.
+
+class DeadReckoning
+{
+public:
+
+    float positionBudget;               ///< position error in meters allowed before an update is required.
+    float orientationBudget;            ///< orientation error (quaternion difference norm) allowed before an update is required.
+    float contactMargin;                ///< distance in meters outside a plane at which contact is predicted.
+    float restingSpeed;                 ///< speed in meters per second below which a body on a plane is held at rest.
+    unsigned int heartbeat;             ///< an update is required at least this often in ticks.
+
+    /// Default constructor.
+
+    DeadReckoning()
+    {
+        positionBudget = 0.1f;
+        orientationBudget = 0.01f;
+        contactMargin = 0.25f;
+        restingSpeed = 0.1f;
+        heartbeat = 100;
+
+        valid = false;
+        contact = false;
+        rest = false;
+        time = 0;
+        resetTime = 0;
+        referenceTime = 0;
+    }
+
+    /// Reset prediction to a state received at time t.
+
+    void reset(unsigned int t, const Cube::State &state, const Cube::Input &input)
+    {
+        this->input = input;
+        time = t;
+        resetTime = t;
+        current = state;
+        rebase();
+        rest = false;
+        valid = true;
+    }
+
+    /// Advance the prediction to time t.
+    /// Times before the current prediction time are ignored.
+    /// @returns the predicted state.
+
+    const Cube::State& predict(unsigned int t, const std::vector<Plane> &planes)
+    {
+        while (valid && time<t)
+            step(planes);
+
+        return current;
+    }
+
+    /// Check if the prediction is too far from the actual state and an update is required.
+
+    bool exceeded(const Cube::State &actual) const
+    {
+        if (!valid)
+            return true;
+
+        if (time - resetTime >= heartbeat)
+            return true;
+
+        return (actual.position - current.position).lengthSquared() > positionBudget * positionBudget ||
+               (actual.orientation - current.orientation).norm() > orientationBudget;
+    }
+
+    /// The current predicted state.
+
+    const Cube::State& state() const
+    {
+        return current;
+    }
+
+    /// True if the last prediction step used full physics because of predicted contact.
+
+    bool simulating() const
+    {
+        return contact;
+    }
+
+    /// True if the last prediction step held the body at rest on a plane.
+
+    bool resting() const
+    {
+        return rest;
+    }
+
+private:
+
+    /// Use the current state as the reference for ballistic prediction.
+
+    void rebase()
+    {
+        reference = current;
+        referenceTime = time;
+
+        std::vector<Plane> none;
+        Cube::calculateForces(input, none, reference, force, torque);
+    }
+
+    /// Advance the prediction by one tick.
+
+    void step(const std::vector<Plane> &planes)
+    {
+        if (settled(current, planes))
+        {
+            // at rest on a plane, hold still
+
+            if (!rest)
+            {
+                current.momentum.zero();
+                current.angularMomentum.zero();
+                current.recalculate();
+                rebase();
+            }
+
+            time++;
+
+            contact = false;
+            rest = true;
+            return;
+        }
+
+        const Cube::State next = ballistic(time + 1 - referenceTime);
+
+        if (touching(current, planes) || touching(next, planes))
+        {
+            // contact predicted, simulate full physics
+
+            cube.snap(current);
+            cube.update(input, planes, timestep);
+            current = cube.state();
+            time++;
+
+            rebase();
+
+            contact = true;
+        }
+        else
+        {
+            current = next;
+            time++;
+
+            if (contact || rest)
+                rebase();
+
+            contact = false;
+        }
+
+        rest = false;
+    }
+
+    /// Closed form prediction of the reference state moving ticks forward under constant force and torque.
+
+    Cube::State ballistic(unsigned int ticks) const
+    {
+        const float t = ticks * timestep;
+
+        Cube::State state = reference;
+
+        state.position = reference.position + reference.velocity * t + force * (0.5f * reference.inverseMass * t * t);
+        state.momentum = reference.momentum + force * t;
+        state.angularMomentum = reference.angularMomentum + torque * t;
+
+        // rotate by the average angular velocity over the interval
+
+        const Vector angularVelocity = (reference.angularMomentum + torque * (0.5f * t)) * reference.inverseInertiaTensor;
+        const float speed = angularVelocity.length();
+
+        if (speed>0.0f)
+            state.orientation = Quaternion(speed * t, angularVelocity / speed) * reference.orientation;
+
+        state.recalculate();
+
+        return state;
+    }
+
+    /// Distance from the cube center to its farthest corner along a direction.
+
+    static float extent(const Cube::State &state, const Vector &normal)
+    {
+        Vector x, y, z;
+        state.bodyToWorld.transform3x3(Vector(1,0,0), x);
+        state.bodyToWorld.transform3x3(Vector(0,1,0), y);
+        state.bodyToWorld.transform3x3(Vector(0,0,1), z);
+
+        return 0.5f * state.size * (fabs(x.dot(normal)) + fabs(y.dot(normal)) + fabs(z.dot(normal)));
+    }
+
+    /// Distance from the lowest corner of the cube to a plane, negative when penetrating.
+
+    static float gap(const Cube::State &state, const Plane &plane)
+    {
+        return state.position.dot(plane.normal) - plane.constant - extent(state, plane.normal);
+    }
+
+    /// Check if contact forces matter for a state.
+    /// True if the cube is penetrating a plane, or closing on one within the contact margin.
+
+    bool touching(const Cube::State &state, const std::vector<Plane> &planes) const
+    {
+        for (unsigned int i=0; i<planes.size(); i++)
+        {
+            const float distance = gap(state, planes[i]);
+
+            if (distance<0.0f)
+                return true;
+
+            if (distance<contactMargin && state.velocity.dot(planes[i].normal)<0.0f)
+                return true;
+        }
+
+        return false;
+    }
+
+    /// Check if a state with no input is lying still and flat on a plane.
+
+    bool settled(const Cube::State &state, const std::vector<Plane> &planes) const
+    {
+        if (input.pack()!=0)
+            return false;
+
+        if (state.velocity.lengthSquared() > restingSpeed * restingSpeed)
+            return false;
+
+        if (state.angularVelocity.lengthSquared() * state.size * state.size > restingSpeed * restingSpeed)
+            return false;
+
+        for (unsigned int i=0; i<planes.size(); i++)
+        {
+            // flat when one face is square on to the plane
+
+            if (fabs(gap(state, planes[i])) < contactMargin && extent(state, planes[i].normal) < 0.505f * state.size)
+                return true;
+        }
+
+        return false;
+    }
+
+    bool valid;                         ///< true once a state has been received.
+    bool contact;                       ///< true if the last step simulated full physics.
+    bool rest;                          ///< true if the last step held the body at rest.
+
+    unsigned int time;                  ///< time of the current prediction.
+    unsigned int resetTime;             ///< time of the last state received.
+    unsigned int referenceTime;         ///< time of the reference state.
+
+    Cube::State reference;              ///< state the ballistic prediction starts from.
+    Cube::State current;                ///< current predicted state.
+    Cube::Input input;                  ///< input held constant over the prediction.
+
+    Vector force;                       ///< force acting at the reference state.
+    Vector torque;                      ///< torque acting at the reference state.
+
+    Cube cube;                          ///< used to simulate full physics while in contact.
+};
@@ -8,14 +8,19 @@ struct Font
 	void initialize()
 	{
 		char system[1024];
+#ifdef _WIN32
 		GetWindowsDirectory(system, sizeof(system));
+		strcat(system, "/fonts");
+#else
+		strcpy(system, "/usr/share/fonts/truetype/msttcorefonts");
+#endif
 		
 		char arial[2048];
-		sprintf(arial, "%s/fonts/arial.ttf", system);
+		sprintf(arial, "%s/arial.ttf", system);
 		title.init(arial, 25);
 		
 		char courier[2048];
-		sprintf(courier, "%s/fonts/courbd.ttf", system);
+		sprintf(courier, "%s/courbd.ttf", system);
 		items.init(courier, 15);
 		status.init(courier, 15);
 	}
@@ -6,7 +6,7 @@
 
 
 //Include our header file.
-#include "freetype.h"
+#include "FreeType.h"
 
 namespace freetype {
 
@@ -19,11 +19,16 @@ inline int next_p2 ( int a )
 	return rval;
 }
 
-///Create a display list coresponding to the give character.
-void make_dlist ( FT_Face face, char ch, GLuint list_base, GLuint * tex_base ) {
+///A rendered character waiting to be packed into the atlas.
+struct glyph_bitmap {
+	int width, rows;				///< Size of the bitmap.
+	int left, top;					///< Bitmap offset from the pen, top is measured up from the baseline.
+	int advance;					///< Pen advance in pixels.
+	vector<unsigned char> pixels;	///< Coverage values, rows top to bottom.
+};
 
-	//The first thing we do is get FreeType to render our character
-	//into a bitmap.  This actually requires a couple of FreeType commands:
+///Render a character with FreeType into a bitmap.
+void load_glyph ( FT_Face face, char ch, glyph_bitmap &output ) {
 
 	//Load the Glyph for our character.
 	if(FT_Load_Glyph( face, FT_Get_Char_Index( face, ch ), FT_LOAD_DEFAULT ))
@@ -41,96 +46,23 @@ void make_dlist ( FT_Face face, char ch, GLuint list_base, GLuint * tex_base ) {
 	//This reference will make accessing the bitmap easier
 	FT_Bitmap& bitmap=bitmap_glyph->bitmap;
 
-	//Use our helper function to get the widths of
-	//the bitmap data that we will need in order to create
-	//our texture.
-	int width = next_p2( bitmap.width );
-	int height = next_p2( bitmap.rows );
-
-	//Allocate memory for the texture data.
-	GLubyte* expanded_data = new GLubyte[ 2 * width * height];
-
-	//Here we fill in the data for the expanded bitmap.
-	//Notice that we are using two channel bitmap (one for
-	//luminocity and one for alpha), but we assign
-	//both luminocity and alpha to the value that we
-	//find in the FreeType bitmap. 
-	//We use the ?: operator so that value which we use
-	//will be 0 if we are in the padding zone, and whatever
-	//is the the Freetype bitmap otherwise.
-	for(int j=0; j <height;j++) {
-		for(int i=0; i < width; i++){
-			expanded_data[2*(i+j*width)]= expanded_data[2*(i+j*width)+1] = 
-				(i>=bitmap.width || j>=bitmap.rows) ?
-				0 : bitmap.buffer[i + bitmap.width*j];
-		}
-	}
-
-
-	//Now we just setup some texture paramaters.
-    glBindTexture( GL_TEXTURE_2D, tex_base[ch]);
-	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
-
-	//Here we actually create the texture itself, notice
-	//that we are using GL_LUMINANCE_ALPHA to indicate that
-	//we are using 2 channel data.
-    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, width, height,
-		  0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, expanded_data );
-
-	//With the texture created, we don't need to expanded data anymore
-    delete [] expanded_data;
-
-	//So now we can create the display list
-	glNewList(list_base+ch,GL_COMPILE);
-
-	glBindTexture(GL_TEXTURE_2D,tex_base[ch]);
+	output.width = bitmap.width;
+	output.rows = bitmap.rows;
+	output.left = bitmap_glyph->left;
+	output.top = bitmap_glyph->top;
+	output.advance = face->glyph->advance.x >> 6;
 
-	glPushMatrix();
-
-	//first we need to move over a little so that
-	//the character has the right amount of space
-	//between it and the one before it.
-	glTranslatef((float)bitmap_glyph->left,0,0);
-
-	//Now we move down a little in the case that the
-	//bitmap extends past the bottom of the line 
-	//(this is only true for characters like 'g' or 'y'.
-	glTranslatef(0,(float)bitmap_glyph->top-bitmap.rows,0);
-
-	//Now we need to account for the fact that many of
-	//our textures are filled with empty padding space.
-	//We figure what portion of the texture is used by 
-	//the actual character and store that information in 
-	//the x and y variables, then when we draw the
-	//quad, we will only reference the parts of the texture
-	//that we contain the character itself.
-	float	x=(float)bitmap.width / (float)width,
-			y=(float)bitmap.rows / (float)height;
-
-	//Here we draw the texturemaped quads.
-	//The bitmap that we got from FreeType was not 
-	//oriented quite like we would like it to be,
-	//so we need to link the texture to the quad
-	//so that the result will be properly aligned.
-	glBegin(GL_QUADS);
-	glTexCoord2d(0,0); glVertex2f(0,(float)bitmap.rows);
-	glTexCoord2d(0,y); glVertex2f(0,0);
-	glTexCoord2d(x,y); glVertex2f((float)bitmap.width,0);
-	glTexCoord2d(x,0); glVertex2f((float)bitmap.width,(float)bitmap.rows);
-	glEnd();
-	glPopMatrix();
-	glTranslatef((float)(face->glyph->advance.x >> 6) ,0,0);
+	//Copy the coverage values row by row since the
+	//FreeType bitmap rows may be padded (pitch).
+	output.pixels.resize(output.width * output.rows);
+	for(int j=0; j<output.rows; j++)
+		for(int i=0; i<output.width; i++)
+			output.pixels[i + j*output.width] = bitmap.buffer[i + bitmap.pitch*j];
 
-	glEndList();
+	FT_Done_Glyph(glyph);
 }
 
-
-
 void font_data::init(const char * fname, unsigned int h) {
-	//Allocate some memory to store the texture ids.
-	textures = new GLuint[128];
-
 	this->h=(float)h;
 
 	//Create and initilize a freetype font library.
@@ -154,33 +86,136 @@ void font_data::init(const char * fname, unsigned int h) {
 	//(h << 6 is just a prettier way of writting h*64)
 	FT_Set_Char_Size( face, h << 6, h << 6, 96, 96);
 
-	//Here we ask opengl to allocate resources for
-	//all the textures and displays lists which we
-	//are about to create.  
-	list_base=glGenLists(128);
-	glGenTextures( 128, textures );
-
-	//This is where we actually create each of the fonts display lists.
+	//Render every character up front.
+	vector<glyph_bitmap> bitmaps(128);
 	for(unsigned char i=0;i<128;i++)
-		make_dlist(face,i,list_base,textures);
+		load_glyph(face,i,bitmaps[i]);
 
-	//We don't need the face information now that the display
-	//lists have been created, so we free the assosiated resources.
+	//We don't need the face information now that the 
+	//bitmaps have been rendered, so we free the assosiated resources.
 	FT_Done_Face(face);
 
 	//Ditto for the library.
 	FT_Done_FreeType(library);
+
+	//Pack the bitmaps into rows (shelves) of a fixed width atlas,
+	//leaving a one pixel gap so linear filtering never picks up
+	//a neighbouring character.
+	const int width = 256;
+	const int padding = 1;
+
+	vector<int> px(128), py(128);
+
+	int x = padding, y = padding, shelf = 0;
+
+	for(int i=0; i<128; i++) {
+		const glyph_bitmap &bitmap = bitmaps[i];
+
+		if (x + bitmap.width + padding > width) {
+			x = padding;
+			y += shelf + padding;
+			shelf = 0;
+		}
+
+		px[i] = x;
+		py[i] = y;
+
+		x += bitmap.width + padding;
+		if (bitmap.rows > shelf)
+			shelf = bitmap.rows;
+	}
+
+	const int height = next_p2( y + shelf + padding );
+
+	//Fill in the atlas. Notice that we are using two channel 
+	//data (one for luminocity and one for alpha), but we assign
+	//both luminocity and alpha to the coverage value.
+	vector<GLubyte> atlas(2 * width * height, 0);
+
+	for(int i=0; i<128; i++) {
+		const glyph_bitmap &bitmap = bitmaps[i];
+
+		for(int j=0; j<bitmap.rows; j++) {
+			for(int k=0; k<bitmap.width; k++) {
+				const int index = 2 * (px[i] + k + (py[i] + j) * width);
+				atlas[index] = atlas[index+1] = bitmap.pixels[k + j*bitmap.width];
+			}
+		}
+
+		//Work out where the character sits relative to the pen, 
+		//moving down a little in the case that the bitmap extends 
+		//past the bottom of the line (characters like 'g' or 'y'),
+		//and what part of the atlas it covers.
+		glyph_data &glyph = glyphs[i];
+		glyph.left = (float) bitmap.left;
+		glyph.bottom = (float) (bitmap.top - bitmap.rows);
+		glyph.width = (float) bitmap.width;
+		glyph.height = (float) bitmap.rows;
+		glyph.advance = (float) bitmap.advance;
+		glyph.s0 = (float) px[i] / width;
+		glyph.t0 = (float) py[i] / height;
+		glyph.s1 = (float) (px[i] + bitmap.width) / width;
+		glyph.t1 = (float) (py[i] + bitmap.rows) / height;
+	}
+
+	//Now we just create the atlas texture.
+	glGenTextures( 1, &texture );
+    glBindTexture( GL_TEXTURE_2D, texture );
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MAG_FILTER,GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_LINEAR);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D( GL_TEXTURE_2D, 0, GL_RGBA, width, height,
+		  0, GL_LUMINANCE_ALPHA, GL_UNSIGNED_BYTE, &atlas[0] );
 }
 
 void font_data::clean() 
 {
-	glDeleteLists(list_base,128);
-	glDeleteTextures(128,textures);
-	delete [] textures;
+	glDeleteTextures(1,&texture);
 }
 
-void print(const font_data &ft_font, float x, float y, const char string[])  
+float layout(const font_data &ft_font, float x, float y, const char string[], vector<float> &vertices)
+{
+	//Window coordinates have y going down, the quads are built 
+	//with y going up from the top of the viewport, so they are
+	//placed at -y here and draw moves them up by the viewport height.
+	float pen = x;
+	const float base = -y;
+
+	for(const unsigned char *c = (const unsigned char*) string; *c; c++) {
+		if (*c >= 128)
+			continue;
+
+		const glyph_data &glyph = ft_font.glyphs[*c];
+
+		if (glyph.width > 0 && glyph.height > 0) {
+			const float x0 = pen + glyph.left;
+			const float y0 = base + glyph.bottom;
+			const float x1 = x0 + glyph.width;
+			const float y1 = y0 + glyph.height;
+
+			//The bitmap rows run top to bottom, so the top
+			//of the quad takes the first row of the bitmap.
+			const float quad[16] = {
+				glyph.s0, glyph.t0, x0, y1,
+				glyph.s0, glyph.t1, x0, y0,
+				glyph.s1, glyph.t1, x1, y0,
+				glyph.s1, glyph.t0, x1, y1
+			};
+
+			vertices.insert(vertices.end(), quad, quad+16);
+		}
+
+		pen += glyph.advance;
+	}
+
+	return pen - x;
+}
+
+void draw(const font_data &ft_font, const vector<float> &vertices)
 {
+	if (vertices.empty())
+		return;
+
 	// push projection matrix
 	glPushAttrib(GL_TRANSFORM_BIT);
 	GLint	viewport[4];
@@ -191,11 +226,7 @@ void print(const font_data &ft_font, float x, float y, const char string[])
 	gluOrtho2D(viewport[0],viewport[2],viewport[1],viewport[3]);
 	glPopAttrib();
 
-	
-	GLuint font=ft_font.list_base;
-	float h=ft_font.h/.63f;								// We make the height about 1.5* that of
-
-	glPushAttrib(GL_LIST_BIT | GL_CURRENT_BIT  | GL_ENABLE_BIT | GL_TRANSFORM_BIT);	
+	glPushAttrib(GL_CURRENT_BIT | GL_ENABLE_BIT | GL_TRANSFORM_BIT | GL_TEXTURE_BIT);	
 	glMatrixMode(GL_MODELVIEW);
 	glDisable(GL_LIGHTING);
 	glEnable(GL_TEXTURE_2D);
@@ -203,25 +234,25 @@ void print(const font_data &ft_font, float x, float y, const char string[])
 	glEnable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);	
 
-	glListBase(font);
+	glBindTexture(GL_TEXTURE_2D, ft_font.texture);
 
 	float modelview_matrix[16];	
 	glGetFloatv(GL_MODELVIEW_MATRIX, modelview_matrix);
 
-	//This is where the text display actually happens.
-	//For each line of text we reset the modelview matrix
-	//so that the line's text will start in the correct position.
-	//Notice that we need to reset the matrix, rather than just translating
-	//down by h. This is because when each character is
-	//draw it modifies the current matrix so that the next character
-	//will be drawn immediatly after it.  
-
+	//The quads are laid out from the top of the viewport,
+	//move them into place and apply the current modelview matrix.
 	glPushMatrix();
 	glLoadIdentity();
-	glTranslatef((float)x,(float)(viewport[3]-y),0);
+	glTranslatef(0,(float)viewport[3],0);
 	glMultMatrixf(modelview_matrix);
 
-	glCallLists((int)(strlen(string)), GL_UNSIGNED_BYTE, string);
+	glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glTexCoordPointer(2, GL_FLOAT, 4*sizeof(float), &vertices[0]);
+	glVertexPointer(2, GL_FLOAT, 4*sizeof(float), &vertices[2]);
+	glDrawArrays(GL_QUADS, 0, (GLsizei) vertices.size() / 4);
+	glPopClientAttrib();
 
 	glPopMatrix();
 
@@ -234,4 +265,11 @@ void print(const font_data &ft_font, float x, float y, const char string[])
 	glPopAttrib();
 }
 
-}
\ No newline at end of file
+void print(const font_data &ft_font, float x, float y, const char string[])  
+{
+	vector<float> vertices;
+	layout(ft_font, x, y, string, vertices);
+	draw(ft_font, vertices);
+}
+
+}
\ No newline at end of file
@@ -9,7 +9,9 @@
 #include "freetype/fttrigon.h"
 
 //OpenGL Headers 
+#ifdef _WIN32
 #include <windows.h>		//(the GL headers need it)
+#endif
 #include <GL/gl.h>
 #include <GL/glu.h>
 
@@ -39,12 +41,23 @@ using std::vector;
 //Ditto for string.
 using std::string;
 
+//Where a character lives in the font's glyph atlas and how
+//to place it relative to the pen.
+struct glyph_data {
+	float left, bottom;		///< Offset of the bitmap from the pen position.
+	float width, height;	///< Size of the bitmap in pixels.
+	float advance;			///< How far to move the pen after this character.
+	float s0, t0, s1, t1;	///< Texture coordinates of the bitmap in the atlas.
+};
+
 //This holds all of the information related to any
 //freetype font that we want to create.  
+//Every character is packed into a single texture so that
+//a whole string can be drawn with one texture and one draw call.
 struct font_data {
-	float h;			///< Holds the height of the font.
-	GLuint * textures;	///< Holds the texture id's 
-	GLuint list_base;	///< Holds the first display list id
+	float h;				///< Holds the height of the font.
+	GLuint texture;			///< Holds the glyph atlas texture id.
+	glyph_data glyphs[128];	///< Holds the atlas placement of each character.
 
 	//The init function will create a font of
 	//of the height h from the file fname.
@@ -54,11 +67,23 @@ struct font_data {
 	void clean();
 };
 
+//Append textured quads for a string to a vertex array, four floats
+//per vertex (s,t,x,y), with the pen starting at window coordinates x,y.
+//The layout does not depend on any OpenGL state so it can be built
+//once and drawn every frame until the string changes.
+//Returns the distance the pen moved.
+float layout(const font_data &ft_font, float x, float y, const char string[], vector<float> &vertices);
+
+//Draw a vertex array built by layout with a single draw call,
+//in the current color with the current modelview matrix applied.
+void draw(const font_data &ft_font, const vector<float> &vertices);
+
 //The flagship function of the library - this thing will print
 //out text at window coordinates x,y, using the font ft_font.
 //The current modelview matrix will also be applied to the text. 
+//Text drawn every frame should use layout and draw instead.
 void print(const font_data &ft_font, float x, float y, const char string[]);
 
 }
 
-#endif
\ No newline at end of file
+#endif
\ No newline at end of file
@@ -0,0 +1,124 @@
+// Headless Linux OpenGL framework
+// Renders into an offscreen pbuffer through EGL with no window or display server,
+// so the same rendering code runs on machines without a display using Mesa's
+// software rasterizer. Define HEADLESS before including the platform headers.
+// There is no input, the program decides when to quit.
+
+#if defined(__linux__) && defined(HEADLESS)
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+
+#include <string.h>
+#include <time.h>
+
+EGLDisplay display = EGL_NO_DISPLAY;
+EGLSurface surface = EGL_NO_SURFACE;
+EGLContext context = EGL_NO_CONTEXT;
+
+int displayWidth = 0;
+int displayHeight = 0;
+bool displayFullscreen = false;
+
+bool openDisplay(const char /*title*/[], int width, int height, bool /*fullscreen*/)
+{
+    displayWidth = width;
+    displayHeight = height;
+    displayFullscreen = false;
+
+    // mesa surfaceless platform needs no display server
+
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+    if (getPlatformDisplay)
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, 0);
+
+    if (display==EGL_NO_DISPLAY)
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display==EGL_NO_DISPLAY || !eglInitialize(display, 0, 0))
+        return false;
+
+    if (!eglBindAPI(EGL_OPENGL_API))
+        return false;
+
+    // choose config
+
+    const EGLint attributes[] = 
+    { 
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT, 
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, 
+        EGL_DEPTH_SIZE, 16, EGL_STENCIL_SIZE, 8, 
+        EGL_NONE 
+    };
+
+    EGLConfig config;
+    EGLint count = 0;
+
+    if (!eglChooseConfig(display, attributes, &config, 1, &count) || count==0)
+        return false;
+
+    // create offscreen surface and context
+
+    const EGLint size[] = { EGL_WIDTH, width, EGL_HEIGHT, height, EGL_NONE };
+
+    surface = eglCreatePbufferSurface(display, config, size);
+    if (surface==EGL_NO_SURFACE)
+        return false;
+
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, 0);
+    if (context==EGL_NO_CONTEXT)
+        return false;
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+        return false;
+
+    glViewport(0, 0, width, height);
+    glScissor(0, 0, width, height);
+
+    return true;
+}
+
+void updateDisplay()
+{
+    // nothing to show, just make sure rendering completes
+
+    glFlush();
+}
+
+void closeDisplay()
+{
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    eglDestroyContext(display, context);
+    context = EGL_NO_CONTEXT;
+
+    eglDestroySurface(display, surface);
+    surface = EGL_NO_SURFACE;
+
+    eglTerminate(display);
+    display = EGL_NO_DISPLAY;
+}
+
+unsigned long long nanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int atomicExchange(volatile int *value, int exchange)
+{
+    return __atomic_exchange_n(value, exchange, __ATOMIC_ACQ_REL);
+}
+
+int atomicLoad(volatile int *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+#endif
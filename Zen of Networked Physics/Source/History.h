@@ -1,7 +1,6 @@
 /// History buffer.
 /// Stores a history of all "moves" (time, input, state) since the last 
-/// correction received from the server, plus a list of all *important moves*
-/// (changes in input) in the same time period.
+/// correction received from the server.
 /// Used in client side prediction to apply server corrections 'in the past'
 /// Press F4 while running to toggle visualization of the history buffer.
 
@@ -9,10 +8,10 @@ class History
 {
 public:
 
-    History(int size = 1000)
+    History(int size = 1024) : moves(size, RingBuffer<Move>::DropOldest)
     {
-        moves.resize(size);
-        importantMoves.resize(size);
+        logfile = 0;
+        evictions = 0;
 
         #ifdef LOGGING
         logfile = fopen("history.log", "w");
@@ -36,30 +35,12 @@ public:
 
         if (logfile)
         {
-            Vector position = move.state.position;
-            Quaternion orientation = move.state.orientation;
-            Cube::Input input = move.input;
+            Vector position = move.position;
+            Quaternion orientation = move.orientation;
+            Cube::Input input = move.input();
             fprintf(logfile, "%d: position=(%f,%f,%f), orientation=(%f,%f,%f,%f), input=(%d,%d,%d,%d,%d)\n", move.time, position.x, position.y, position.z, orientation.w, orientation.x, orientation.y, orientation.z, input.left, input.right, input.forward, input.back, input.jump);
         }
 
-        // determine if important move
-
-        bool important = true;
-
-        if (!moves.empty())
-        {
-            const Move &previous = moves.newest();
-
-            important = move.input.left!=previous.input.left || 
-                        move.input.right!=previous.input.right ||
-                        move.input.forward!=previous.input.forward ||
-                        move.input.back!=previous.input.back ||
-                        move.input.jump!=previous.input.jump;
-        }
-
-        if (important)
-            importantMoves.add(move);
-
         // add move to history
 
         moves.add(move);
@@ -67,247 +48,237 @@ public:
 
     void correction(Scene &scene, unsigned int t, const Cube::State &state, const Cube::Input &input)
     {
-        // discard out of date important moves 
-
-        while (importantMoves.oldest().time<t && !importantMoves.empty())
-            importantMoves.remove();
+        Profiler::Timer timer(profiler, Profiler::HistoryCorrection);
 
         // discard out of date moves
 
-        while (moves.oldest().time<t && !moves.empty())
+        while (!moves.empty() && moves.oldest().time<t)
             moves.remove();
         
         if (moves.empty())
             return;
 
-        // compare correction state with move history state
+        // compare correction state with move history state.
+        // if the corrected move was dropped because the history was full there is
+        // nothing to compare against, so snap to the correction and replay anyway
 
-        if (state!=moves.oldest().state)
+        if (moves.oldest().time==t)
         {
+            if (moves.oldest().matches(state))
+                return;
+
             // discard corrected move
 
             moves.remove();
+        }
+        else
+        {
+            evictions++;
+            trace.instant("correction evicted", Profiler::Simulation, "oldest", moves.oldest().time);
+        }
 
-            // save current scene data
+        // save current scene data
 
-            unsigned int savedTime = scene.time;
-            Cube::Input savedInput = scene.input;
+        unsigned int savedTime = scene.time;
+        Cube::Input savedInput = scene.input;
 
-            // rewind to correction and replay moves
+        // rewind to correction and replay moves
 
-            scene.time = t;
-            scene.input = input;
-            scene.cube.snap(state);
+        const unsigned long long start = nanoseconds();
 
-            scene.replaying = true;
+        scene.time = t;
+        scene.input = input;
+        scene.cube.snap(state);
 
-            int i = moves.tail;
+        scene.replaying = true;
 
-            while (i!=moves.head)
-            {
-                while (scene.time<moves[i].time)
-                    scene.update(scene.time);
-                scene.input = moves[i].input;
-                moves[i].state = scene.cube.state();
-                moves.next(i);
-            }
+        unsigned int i = moves.tail();
 
-            scene.update(scene.time);
-            
-            scene.replaying = false;
+        while (i!=moves.head())
+        {
+            while (scene.time<moves[i].time)
+                scene.update(scene.time);
+            scene.input = moves[i].input();
+            moves[i].store(scene.cube.state());
+            moves.next(i);
+        }
 
-            // restore saved input
+        scene.update(scene.time);
+        
+        scene.replaying = false;
 
-            scene.input = savedInput;
-        }
+        trace.complete("replay", Profiler::Simulation, start, nanoseconds(), "moves", moves.size());
+
+        // restore saved input
+
+        scene.input = savedInput;
     }
 
-    /// render history buffer as a cool trail
+    /// copy the moves in the history buffer, oldest first.
+    /// used to hand the history to the renderer, see Snapshot.
 
-    void render()
+    void capture(std::vector<Move> &output) const
     {
-        int i = moves.tail;
+        output.clear();
 
-        glDepthMask(GL_FALSE);
-        glDisable(GL_CULL_FACE);
+        for (unsigned int i=moves.tail(); i!=moves.head(); moves.next(i))
+            output.push_back(moves[i]);
+    }
 
-        glEnable(GL_BLEND);
-        glBlendFunc(GL_ONE, GL_ONE);
+    /// render captured history moves as a cool trail.
+    /// the trail quads for all moves are built into one vertex array and drawn with a single call.
+    /// @param moves history moves, oldest first.
+    /// @param size length of the cube sides, moves only store the primary state.
+    /// @param trail vertex storage, kept by the caller between frames.
+    /// @param frustum moves outside the view frustum are skipped.
+    /// @param distance moves further than this from the eye are skipped.
+    /// @returns the number of moves skipped.
+
+    static int render(const std::vector<Move> &moves, float size, std::vector<float> &trail, const Frustum &frustum, float distance)
+    {
+        // cube edges joining corners, each edge sweeps out a quad between consecutive moves
+
+        static const int edges[12][2] = 
+        { 
+            {0,1}, {1,2}, {2,3}, {3,0}, 
+            {4,5}, {5,6}, {6,7}, {7,4}, 
+            {0,4}, {1,5}, {2,6}, {3,7} 
+        };
 
-        Cube::State previous;
+        static const Vector unit[8] =
+        {
+            Vector(-1,-1,-1), Vector(+1,-1,-1), Vector(+1,+1,-1), Vector(-1,+1,-1),
+            Vector(-1,-1,+1), Vector(+1,-1,+1), Vector(+1,+1,+1), Vector(-1,+1,+1)
+        };
+
+        const float s = size * 0.5f;
+        const float radius = size * 0.8660254f;
+
+        trail.clear();
+
+        int skipped = 0;
+
+        Vector previous[8];
+        Vector current[8];
 
         int count = 0;
 
-        while (i!=moves.head)
+        for (unsigned int i=0; i<moves.size(); i++)
         {
-            const Cube::State &state = moves[i].state;
+            // skip moves out of view or too far away, the trail restarts at the next move kept
 
-            if (count++==0)
+            if ((moves[i].position - frustum.eye).lengthSquared() > distance * distance || !frustum.visible(moves[i].position, radius))
             {
-                previous = state;
+                skipped++;
+                count = 0;
                 continue;
             }
 
-            Vector a = state.bodyToWorld * (Vector(-1,-1,-1) * state.size * 0.5);
-            Vector b = state.bodyToWorld * (Vector(+1,-1,-1) * state.size * 0.5);
-            Vector c = state.bodyToWorld * (Vector(+1,+1,-1) * state.size * 0.5);
-            Vector d = state.bodyToWorld * (Vector(-1,+1,-1) * state.size * 0.5);
-            Vector e = state.bodyToWorld * (Vector(-1,-1,+1) * state.size * 0.5);
-            Vector f = state.bodyToWorld * (Vector(+1,-1,+1) * state.size * 0.5);
-            Vector g = state.bodyToWorld * (Vector(+1,+1,+1) * state.size * 0.5);
-            Vector h = state.bodyToWorld * (Vector(-1,+1,+1) * state.size * 0.5);
-
-            Vector _a = previous.bodyToWorld * (Vector(-1,-1,-1) * previous.size * 0.5);
-            Vector _b = previous.bodyToWorld * (Vector(+1,-1,-1) * previous.size * 0.5);
-            Vector _c = previous.bodyToWorld * (Vector(+1,+1,-1) * previous.size * 0.5);
-            Vector _d = previous.bodyToWorld * (Vector(-1,+1,-1) * previous.size * 0.5);
-            Vector _e = previous.bodyToWorld * (Vector(-1,-1,+1) * previous.size * 0.5);
-            Vector _f = previous.bodyToWorld * (Vector(+1,-1,+1) * previous.size * 0.5);
-            Vector _g = previous.bodyToWorld * (Vector(+1,+1,+1) * previous.size * 0.5);
-            Vector _h = previous.bodyToWorld * (Vector(-1,+1,+1) * previous.size * 0.5);
-            
-            previous = state;
-
-            glBegin(GL_QUADS);
-                
-                glColor3f(0.02f, 0.02f, 0.02f);
-
-                quad(a, b, _b, _a);
-                quad(b, c, _c, _b);
-                quad(c, d, _d, _c);
-                quad(d, a, _a, _d);
-
-                quad(e, f, _f, _e);
-                quad(f, g, _g, _f);
-                quad(g, h, _h, _g);
-                quad(h, e, _e, _h);
-
-                quad(a, e, _e, _a);
-                quad(b, f, _f, _b);
-                quad(c, g, _g, _c);
-                quad(d, h, _h, _d);
-
-            glEnd();
+            const Matrix transform = moves[i].transform();
 
-            moves.next(i);
-        }
-
-        glDisable(GL_BLEND);
+            for (int j=0; j<8; j++)
+                current[j] = transform * (unit[j] * s);
 
-        glDepthMask(GL_TRUE);
-        glEnable(GL_CULL_FACE);
-    }
-
-    /// get important moves in a std::vector form
+            if (count++>0)
+            {
+                for (int j=0; j<12; j++)
+                {
+                    const Vector &a = current[edges[j][0]];
+                    const Vector &b = current[edges[j][1]];
+                    const Vector &_a = previous[edges[j][0]];
+                    const Vector &_b = previous[edges[j][1]];
+
+                    vertex(trail, a);
+                    vertex(trail, b);
+                    vertex(trail, _b);
+                    vertex(trail, _a);
+                }
+            }
 
-    void importantMoveArray(std::vector<Move> &array)
-    {
-        const int size = importantMoves.size();
+            for (int j=0; j<8; j++)
+                previous[j] = current[j];
+        }
 
-        array.resize(size);
+        if (trail.empty())
+            return skipped;
 
-        int i = importantMoves.tail;
+        glDepthMask(GL_FALSE);
+        glDisable(GL_CULL_FACE);
 
-        for (int j=0; j<size; j++)
-        {
-            array[j] = importantMoves[i];
-            importantMoves.next(i);
-        }
-    }
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
 
-private:
+        glColor3f(0.02f, 0.02f, 0.02f);
 
-    /// circular buffer class
+        glPushClientAttrib(GL_CLIENT_VERTEX_ARRAY_BIT);
+        glEnableClientState(GL_VERTEX_ARRAY);
+        glVertexPointer(3, GL_FLOAT, 0, &trail[0]);
+        glDrawArrays(GL_QUADS, 0, (GLsizei) trail.size() / 3);
+        glPopClientAttrib();
 
-    struct CircularBuffer
-    {
-        int head;
-        int tail;
+        glDisable(GL_BLEND);
 
-        CircularBuffer()
-        {
-            head = 0;
-            tail = 0;
-        }
+        glDepthMask(GL_TRUE);
+        glEnable(GL_CULL_FACE);
 
-        void resize(int size)
-        {
-            head = 0;
-            tail = 0;
-            moves.resize(size);
-        }
+        return skipped;
+    }
 
-        int size()
-        {
-            int count = head - tail;
-            if (count<0)
-                count += (int) moves.size();
-            return count;
-        }
+    /// get the inputs of all moves at or after time t.
+    /// only the most recent moves are added if there are more than fit in the window.
+    /// @param t the time of the first input wanted.
+    /// @param window the window to fill with inputs.
+    /// @param reserve number of slots to leave free for inputs added to the window afterwards.
 
-        void add(const Move &move)
-        {
-            moves[head] = move;
-            next(head);
+    void inputs(unsigned int t, InputWindow &window, int reserve = 0)
+    {
+        unsigned int i = moves.tail();
 
-        }
+        while (i!=moves.head() && moves[i].time<t)
+            moves.next(i);
 
-        void remove()
-        {
-            assert(!empty());
-            next(tail);
-        }
+        int count = 0;
 
-        Move& oldest()
-        {
-            assert(!empty());
-            return moves[tail];
-        }
+        for (unsigned int j=i; j!=moves.head(); moves.next(j))
+            count++;
 
-        Move& newest()
-        {
-            assert(!empty());
-            int index = head-1;
-            if (index==-1)
-                index = (int) moves.size() - 1;
-            return moves[index];
-        }
+        for (; count>InputWindow::Size-reserve; count--)
+            moves.next(i);
 
-        bool empty() const
-        {
-            return head==tail;
-        }
+        window.clear(i!=moves.head() ? moves[i].time : t);
 
-        void next(int &index)
+        while (i!=moves.head())
         {
-            index ++;
-            if (index>=(int)moves.size()) 
-                index -= (int)moves.size();
+            window.add(moves[i].input());
+            moves.next(i);
         }
+    }
 
-        void previous(int &index)
-        {
-            index --;
-            if (index<0)
-                index += (int)moves.size();
-        }
+    /// history buffer statistics
 
-        Move& operator[](int index)
-        {
-            assert(index>=0);
-            assert(index<(int)moves.size());
-            return moves[index];
-        }
+    const RingBuffer<Move>::Statistics& stats() const
+    {
+        return moves.stats();
+    }
 
-    private:
+    /// number of corrections for moves already dropped from the full history
 
-        std::vector<Move> moves;
-    };
+    unsigned int evicted() const
+    {
+        return evictions;
+    }
 
 private:
 
-    CircularBuffer moves;                       ///< stores all recent moves
-    CircularBuffer importantMoves;              ///< stores recent *important* moves
+    static void vertex(std::vector<float> &trail, const Vector &v)
+    {
+        trail.push_back(v.x);
+        trail.push_back(v.y);
+        trail.push_back(v.z);
+    }
+
+    RingBuffer<Move> moves;                     ///< stores all recent moves, the oldest are dropped when full
+    unsigned int evictions;                     ///< corrections that found their move already dropped
 
     FILE *logfile;
 };
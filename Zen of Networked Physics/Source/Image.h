@@ -0,0 +1,138 @@
+/// Image.
+/// An RGB image with 8 bits per channel, stored top row first, which can be
+/// read from and written to binary PPM files. Used to dump rendered frames
+/// and compare them for visual regression testing, see Compare.cpp.
+
+struct Image
+{
+    int width;                          ///< width in pixels.
+    int height;                         ///< height in pixels.
+    std::vector<unsigned char> pixels;  ///< red, green and blue for each pixel, top row first.
+
+    /// Result of comparing two images.
+
+    struct Difference
+    {
+        int pixels;                     ///< pixels with a channel differing by more than the tolerance.
+        int maximum;                    ///< largest difference in any channel.
+        double mean;                    ///< mean absolute difference over all channels.
+    };
+
+    Image()
+    {
+        width = 0;
+        height = 0;
+    }
+
+    /// Set the image size, all pixels are black.
+
+    void resize(int width, int height)
+    {
+        this->width = width;
+        this->height = height;
+        pixels.assign(width * height * 3, 0);
+    }
+
+    /// Write the image as a binary PPM file.
+    /// @returns false if the file could not be written.
+
+    bool write(const char filename[]) const
+    {
+        FILE *file = fopen(filename, "wb");
+
+        if (!file)
+            return false;
+
+        fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+        const bool written = fwrite(&pixels[0], 1, pixels.size(), file)==pixels.size();
+
+        fclose(file);
+
+        return written;
+    }
+
+    /// Read a binary PPM file with 8 bits per channel.
+    /// @returns false if the file could not be read or is not a binary PPM.
+
+    bool read(const char filename[])
+    {
+        FILE *file = fopen(filename, "rb");
+
+        if (!file)
+            return false;
+
+        int w = 0;
+        int h = 0;
+        int maximum = 0;
+
+        if (fscanf(file, "P6 %d %d %d", &w, &h, &maximum)!=3 || w<=0 || h<=0 || maximum!=255 || fgetc(file)==EOF)
+        {
+            fclose(file);
+            return false;
+        }
+
+        resize(w, h);
+
+        const bool read = fread(&pixels[0], 1, pixels.size(), file)==pixels.size();
+
+        fclose(file);
+
+        return read;
+    }
+
+    /// Compare two images of the same size.
+    /// @param tolerance largest difference allowed in a channel before a pixel counts as different.
+    /// @param difference receives the comparison result.
+    /// @param diff if not null, receives an image with differing pixels in white over a dimmed copy of a.
+    /// @returns false if the images are not the same size.
+
+    static bool compare(const Image &a, const Image &b, int tolerance, Difference &difference, Image *diff = 0)
+    {
+        difference.pixels = 0;
+        difference.maximum = 0;
+        difference.mean = 0.0;
+
+        if (a.width!=b.width || a.height!=b.height)
+            return false;
+
+        if (diff)
+            diff->resize(a.width, a.height);
+
+        double total = 0.0;
+
+        const int count = a.width * a.height;
+
+        for (int i=0; i<count; i++)
+        {
+            int largest = 0;
+
+            for (int j=0; j<3; j++)
+            {
+                const int d = abs(a.pixels[i*3+j] - b.pixels[i*3+j]);
+                total += d;
+                if (d>largest)
+                    largest = d;
+            }
+
+            if (largest>difference.maximum)
+                difference.maximum = largest;
+
+            const bool different = largest>tolerance;
+
+            if (different)
+                difference.pixels++;
+
+            if (diff)
+            {
+                for (int j=0; j<3; j++)
+                    diff->pixels[i*3+j] = different ? 255 : a.pixels[i*3+j] / 4;
+            }
+        }
+
+        if (count>0)
+            difference.mean = total / (count * 3);
+
+        return true;
+    }
+};
@@ -36,6 +36,7 @@ struct Input
                 case F7: printf("f7 key pressed\n"); break;
                 case F8: printf("f8 key pressed\n"); break;
                 case F9: printf("f9 key pressed\n"); break;
+                case F10: printf("f10 key pressed\n"); break;
             }
         }
     };
@@ -136,6 +137,9 @@ struct Input
 
                 if (current.f9 && !previous.f9)
                     listener->pressed(F9);
+
+                if (current.f10 && !previous.f10)
+                    listener->pressed(F10);
             }
 
             // set to previous
@@ -145,7 +149,7 @@ struct Input
             // log to "input.log" to enable playback later
 
             #ifdef LOGGING
-            fprintf( logfile, "%d: %d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", 
+            fprintf( logfile, "%d: %d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n", 
                      t,
                      current.left, 
                      current.right, 
@@ -165,7 +169,8 @@ struct Input
                      current.f6, 
                      current.f7, 
                      current.f8,
-                     current.f9 );
+                     current.f9,
+                     current.f10 );
             #endif
         }
 
@@ -251,6 +256,10 @@ struct Input
             case F9:
                 current.f9 = true;
                 break;
+
+            case F10:
+                current.f10 = true;
+                break;
         }
     }
 
@@ -333,6 +342,10 @@ struct Input
             case F9:
                 current.f9 = false;
                 break;
+
+            case F10:
+                current.f10 = false;
+                break;
         }
     }
 
@@ -440,6 +453,11 @@ struct Input
         return current.f9;
     }
 
+    bool f10() const
+    {
+        return current.f10;
+    }
+
     Listener *listener;             ///< if non-null this object is notified of key presses.
 
 private: 
@@ -465,6 +483,7 @@ private:
         bool f7;
         bool f8;
         bool f9;
+        bool f10;
 
         bool operator==(const Data &other) const
         {
@@ -486,7 +505,8 @@ private:
                    f6==other.f6 && 
                    f7==other.f7 && 
                    f8==other.f8 &&
-                   f9==other.f9;
+                   f9==other.f9 &&
+                   f10==other.f10;
         }
 
         bool operator!=(const Data &other) const
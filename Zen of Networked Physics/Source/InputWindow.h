@@ -0,0 +1,95 @@
+/// Input window.
+/// A contiguous range of client inputs sent redundantly from client to server.
+/// Each input is bit packed into five bits. The client sends every input the
+/// server has not yet acknowledged with each packet, so a lost packet costs
+/// nothing as long as a later packet arrives, while the window size bounds the
+/// packet size even when acks stop arriving under heavy packet loss.
+
+struct InputWindow
+{
+    enum
+    {
+        Size = 64,                      ///< maximum number of inputs in a window.
+        Words = (Size * Cube::Input::Bits + 31) / 32
+    };
+
+    unsigned int first;                 ///< time of the first input in the window.
+    int count;                          ///< number of inputs in the window.
+
+    InputWindow()
+    {
+        clear(0);
+    }
+
+    /// clear the window so that the next input added is for time t
+
+    void clear(unsigned int t)
+    {
+        first = t;
+        count = 0;
+        memset(data, 0, sizeof(data));
+    }
+
+    /// add input for the next time in the window.
+    /// if the window is full the oldest input is discarded.
+
+    void add(const Cube::Input &input)
+    {
+        if (count==Size)
+        {
+            InputWindow shifted;
+            shifted.clear(first+1);
+            for (int i=1; i<count; i++)
+                shifted.add(get(i));
+            *this = shifted;
+        }
+
+        const unsigned int bit = count * Cube::Input::Bits;
+        const unsigned int value = input.pack();
+
+        data[bit>>5] |= value << (bit&31);
+
+        if ((bit&31) + Cube::Input::Bits > 32)
+            data[(bit>>5)+1] |= value >> (32 - (bit&31));
+
+        count++;
+    }
+
+    /// get input at index i in the window, the input for time first+i
+
+    Cube::Input get(int i) const
+    {
+        assert(i>=0);
+        assert(i<count);
+
+        const unsigned int bit = i * Cube::Input::Bits;
+
+        unsigned int value = data[bit>>5] >> (bit&31);
+
+        if ((bit&31) + Cube::Input::Bits > 32)
+            value |= data[(bit>>5)+1] << (32 - (bit&31));
+
+        Cube::Input input;
+        input.unpack(value);
+        return input;
+    }
+
+    /// time of the last input in the window
+
+    unsigned int last() const
+    {
+        assert(count>0);
+        return first + count - 1;
+    }
+
+    /// size of the window in bytes when sent over the network
+
+    int bytes() const
+    {
+        return sizeof(first) + 1 + (count * Cube::Input::Bits + 7) / 8;
+    }
+
+private:
+
+    unsigned int data[Words];           ///< packed input bits
+};
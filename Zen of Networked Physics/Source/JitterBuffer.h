@@ -0,0 +1,254 @@
+/// Jitter buffer.
+/// Buffers input received from a client so the server can play it out at a
+/// steady rate of one tick per server update instead of stepping in bursts
+/// whenever a packet arrives. Playout is held back by a small number of ticks
+/// (the depth) behind the most recent input received. The depth adapts, growing
+/// each time the buffer runs dry and shrinking again after a period of smooth
+/// playout, with the measured transit jitter as a lower bound.
+
+class JitterBuffer
+{
+public:
+
+    /// Jitter buffer statistics.
+
+    struct Statistics
+    {
+        int depth;                      ///< current playout depth in ticks.
+        int buffered;                   ///< number of ticks of input buffered ahead of playout.
+        float jitter;                   ///< smoothed transit jitter in ticks.
+        unsigned int late;              ///< inputs that arrived after their tick was played out.
+        unsigned int dropped;           ///< inputs discarded because they were too far ahead to buffer.
+        unsigned int missing;           ///< ticks played out without input, the previous input was used.
+        unsigned int underruns;         ///< updates where the buffer was empty and playout had to wait.
+    };
+
+    int minimumDepth;                   ///< minimum playout depth in ticks.
+    int maximumDepth;                   ///< maximum playout depth in ticks.
+    int shrinkTime;                     ///< ticks of smooth playout before the depth is reduced.
+
+    /// Constructor.
+    /// @param size number of ticks of input that can be buffered.
+
+    JitterBuffer(int size = 256)
+    {
+        slots.resize(size);
+
+        minimumDepth = 1;
+        maximumDepth = 32;
+        shrinkTime = 500;
+
+        clear();
+    }
+
+    /// Clear the buffer, playout starts from the first input received.
+
+    void clear()
+    {
+        for (unsigned int i=0; i<slots.size(); i++)
+            slots[i].valid = false;
+
+        next = 0;
+        newest = 0;
+        contiguous = 0;
+        started = false;
+        depth = minimumDepth;
+        smooth = 0;
+        transit = 0;
+        input.unpack(0);
+
+        memset(&statistics, 0, sizeof(statistics));
+        statistics.depth = depth;
+    }
+
+    /// Insert a single input received at local time t.
+    /// @param t local time of arrival.
+    /// @param time time of the input.
+    /// @param input the input value.
+
+    void insert(unsigned int t, unsigned int time, const Cube::Input &input)
+    {
+        const bool first = !started;
+
+        if (first)
+        {
+            next = time;
+            newest = time;
+            contiguous = time;
+            started = true;
+        }
+
+        Slot &slot = slots[time % slots.size()];
+
+        if (time<next)
+        {
+            // already played out, count it as late unless we have seen it before
+
+            if (!(slot.valid && slot.time==time) && next-time<slots.size())
+                statistics.late++;
+            return;
+        }
+
+        if (time>=next+slots.size())
+        {
+            statistics.dropped++;
+            return;
+        }
+
+        slot.time = time;
+        slot.input = input;
+        slot.valid = true;
+
+        if (time>newest || first)
+        {
+            // track transit jitter as the smoothed change in arrival offset
+
+            const int offset = (int) (t - time);
+
+            if (!first)
+            {
+                const int difference = offset - transit;
+                statistics.jitter += ((difference<0 ? -difference : difference) - statistics.jitter) / 16.0f;
+            }
+
+            transit = offset;
+            newest = time;
+        }
+
+        advance();
+    }
+
+    /// Insert a window of inputs received at local time t.
+
+    void insert(unsigned int t, const InputWindow &window)
+    {
+        for (int i=0; i<window.count; i++)
+            insert(t, window.first + i, window.get(i));
+    }
+
+    /// Get the number of ticks to play out this update.
+    /// Normally one tick, zero while the buffer is filling or empty, and two when
+    /// the buffer is far ahead of the target depth so playout catches up.
+
+    int ready()
+    {
+        const int available = started ? (int) (newest + 1 - next) : 0;
+
+        statistics.buffered = available;
+
+        // adapt depth
+
+        const int lowest = maximum(minimumDepth, (int) ceil(statistics.jitter * 2.0f));
+
+        if (available==0 && started)
+        {
+            statistics.underruns++;
+            depth = depth<maximumDepth ? depth+1 : maximumDepth;
+            smooth = 0;
+        }
+        else if (++smooth>=shrinkTime)
+        {
+            smooth = 0;
+            if (depth>lowest)
+                depth--;
+        }
+
+        if (depth<lowest)
+            depth = lowest;
+
+        statistics.depth = depth;
+
+        // determine ticks to play out
+
+        if (available<=depth)
+            return 0;
+
+        if (available>depth*2+2)
+            return 2;
+
+        return 1;
+    }
+
+    /// Play out input for the next tick.
+    /// If no input was received for the tick the previous input is repeated.
+    /// @returns the time of the input played out.
+
+    unsigned int playout(Cube::Input &input)
+    {
+        Slot &slot = slots[next % slots.size()];
+
+        if (slot.valid && slot.time==next)
+            this->input = slot.input;
+        else
+            statistics.missing++;
+
+        input = this->input;
+
+        const unsigned int time = next++;
+
+        advance();
+
+        return time;
+    }
+
+    /// All input before this time has been received or is no longer needed
+    /// because its tick has been played out. Input received after a gap does
+    /// not count until the gap is filled.
+
+    unsigned int received() const
+    {
+        return started ? contiguous : 0;
+    }
+
+    /// Jitter buffer statistics.
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+private:
+
+    static int maximum(int a, int b)
+    {
+        return a>b ? a : b;
+    }
+
+    /// Move contiguous past played out ticks and every input received without a gap.
+
+    void advance()
+    {
+        if (contiguous<next)
+            contiguous = next;
+
+        while (contiguous<=newest)
+        {
+            const Slot &slot = slots[contiguous % slots.size()];
+
+            if (!slot.valid || slot.time!=contiguous)
+                break;
+
+            contiguous++;
+        }
+    }
+
+    struct Slot
+    {
+        unsigned int time;
+        Cube::Input input;
+        bool valid;
+    };
+
+    std::vector<Slot> slots;            ///< buffered input indexed by time modulo size.
+
+    unsigned int next;                  ///< time of the next input to play out.
+    unsigned int newest;                ///< time of the most recent input received.
+    unsigned int contiguous;            ///< time of the first input not yet received that is still needed.
+    bool started;                       ///< true once the first input has been received.
+    int depth;                          ///< current playout depth in ticks.
+    int smooth;                         ///< ticks since the buffer last ran dry.
+    int transit;                        ///< arrival offset of the most recent input.
+    Cube::Input input;                  ///< most recent input played out.
+
+    Statistics statistics;
+};
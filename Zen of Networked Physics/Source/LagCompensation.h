@@ -0,0 +1,271 @@
+/// Lag compensation.
+/// Keeps a ring of recent body transforms on the server so hit queries made by
+/// a client can be checked against the world as that client saw it, roughly
+/// one latency in the past, without rewinding or re-simulating the physics.
+/// Each frame stores only what queries need: the body transform, half size and
+/// a world space bounding box computed once when the frame is recorded.
+
+class LagCompensation
+{
+public:
+
+    /// Body transform recorded for a frame.
+
+    struct Record
+    {
+        int id;                         ///< body id.
+        Vector position;                ///< position of the body center.
+        Quaternion orientation;         ///< orientation of the body.
+        float halfSize;                 ///< half the length of the cube sides.
+        float radius;                   ///< bounding sphere radius.
+        Vector minimum;                 ///< minimum corner of the world space bounding box.
+        Vector maximum;                 ///< maximum corner of the world space bounding box.
+    };
+
+    /// Result of a ray query.
+
+    struct Hit
+    {
+        int id;                         ///< id of the body hit.
+        float distance;                 ///< distance along the ray to the hit point.
+        Vector point;                   ///< hit point in world space.
+    };
+
+    /// Constructor.
+    /// @param size number of ticks of history to keep.
+
+    LagCompensation(int size = 128)
+    {
+        frames.resize(size);
+        clear();
+    }
+
+    /// Discard all history.
+
+    void clear()
+    {
+        for (unsigned int i=0; i<frames.size(); i++)
+        {
+            frames[i].valid = false;
+            frames[i].records.clear();
+        }
+
+        newest = 0;
+        recording = 0;
+    }
+
+    /// Start recording the frame for time t.
+    /// Any frame previously stored in the same slot is overwritten.
+
+    void begin(unsigned int t)
+    {
+        recording = &frames[t % frames.size()];
+        recording->time = t;
+        recording->valid = true;
+        recording->records.clear();
+
+        if (t>newest)
+            newest = t;
+    }
+
+    /// Record a body transform in the current frame.
+
+    void add(int id, const Cube::State &state)
+    {
+        assert(recording);
+
+        Record record;
+        record.id = id;
+        record.position = state.position;
+        record.orientation = state.orientation;
+        record.halfSize = state.size * 0.5f;
+        record.radius = record.halfSize * 1.7320508f;
+
+        // world bounding box of the rotated cube
+
+        const Matrix &m = state.bodyToWorld;
+
+        const Vector extent(
+            record.halfSize * (fabs(m.m11) + fabs(m.m12) + fabs(m.m13)),
+            record.halfSize * (fabs(m.m21) + fabs(m.m22) + fabs(m.m23)),
+            record.halfSize * (fabs(m.m31) + fabs(m.m32) + fabs(m.m33)));
+
+        record.minimum = record.position - extent;
+        record.maximum = record.position + extent;
+
+        recording->records.push_back(record);
+    }
+
+    /// Get the time to rewind to for a query from a client.
+    /// @param now current server time.
+    /// @param latency one way latency of the client in seconds.
+    /// @returns the most recent time with history at or before now minus latency,
+    /// clamped to the oldest time still in the ring.
+
+    unsigned int rewind(unsigned int now, float latency) const
+    {
+        const unsigned int ticks = (unsigned int) (latency / timestep + 0.5f);
+
+        unsigned int t = ticks<now ? now - ticks : 0;
+
+        if (t>newest)
+            t = newest;
+
+        if (newest - t >= frames.size())
+            t = newest - frames.size() + 1;
+
+        return t;
+    }
+
+    /// Get the recorded frame for time t.
+    /// @returns the records for that time, or null if the time is not in the ring.
+
+    const std::vector<Record>* frame(unsigned int t) const
+    {
+        const Frame &frame = frames[t % frames.size()];
+
+        if (!frame.valid || frame.time!=t)
+            return 0;
+
+        return &frame.records;
+    }
+
+    /// Cast a ray against the bodies as they were at time t.
+    /// @param t time to query.
+    /// @param origin ray origin in world space.
+    /// @param direction ray direction, must be unit length.
+    /// @param length maximum distance along the ray.
+    /// @param hit receives the closest hit.
+    /// @returns true if a body was hit.
+
+    bool raycast(unsigned int t, const Vector &origin, const Vector &direction, float length, Hit &hit) const
+    {
+        const std::vector<Record> *records = frame(t);
+
+        if (!records)
+            return false;
+
+        bool found = false;
+
+        hit.distance = length;
+
+        for (unsigned int i=0; i<records->size(); i++)
+        {
+            const Record &record = (*records)[i];
+
+            // reject using bounding sphere
+
+            const Vector offset = record.position - origin;
+            const float along = offset.dot(direction);
+            const float perpendicular = offset.lengthSquared() - along * along;
+
+            if (perpendicular>record.radius*record.radius || along+record.radius<0 || along-record.radius>hit.distance)
+                continue;
+
+            // slab test in body space
+
+            Quaternion inverse;
+            record.orientation.conjugate(inverse);
+
+            const Vector start = rotate(inverse, origin - record.position);
+            const Vector ray = rotate(inverse, direction);
+
+            float enter = 0.0f;
+            float exit = hit.distance;
+
+            if (!slab(start.x, ray.x, record.halfSize, enter, exit) ||
+                !slab(start.y, ray.y, record.halfSize, enter, exit) ||
+                !slab(start.z, ray.z, record.halfSize, enter, exit))
+                continue;
+
+            hit.id = record.id;
+            hit.distance = enter;
+            found = true;
+        }
+
+        if (found)
+            hit.point = origin + direction * hit.distance;
+
+        return found;
+    }
+
+    /// Find bodies overlapping an axis aligned box as they were at time t.
+    /// Uses the recorded world bounding boxes so the test is conservative for rotated bodies.
+    /// @param ids receives the ids of the overlapping bodies.
+    /// @returns the number of bodies found.
+
+    int overlap(unsigned int t, const Vector &minimum, const Vector &maximum, std::vector<int> &ids) const
+    {
+        ids.clear();
+
+        const std::vector<Record> *records = frame(t);
+
+        if (!records)
+            return 0;
+
+        for (unsigned int i=0; i<records->size(); i++)
+        {
+            const Record &record = (*records)[i];
+
+            if (record.minimum.x<=maximum.x && record.maximum.x>=minimum.x &&
+                record.minimum.y<=maximum.y && record.maximum.y>=minimum.y &&
+                record.minimum.z<=maximum.z && record.maximum.z>=minimum.z)
+                ids.push_back(record.id);
+        }
+
+        return (int) ids.size();
+    }
+
+private:
+
+    /// Rotate a vector by a unit quaternion.
+
+    static Vector rotate(const Quaternion &q, const Vector &v)
+    {
+        const Vector u(q.x, q.y, q.z);
+        const Vector t = u.cross(v) * 2.0f;
+        return v + t * q.w + u.cross(t);
+    }
+
+    /// Clip the ray interval [enter,exit] against a slab [-h,h] on one axis.
+    /// @returns false if the interval becomes empty.
+
+    static bool slab(float start, float direction, float h, float &enter, float &exit)
+    {
+        if (fabs(direction)<1e-8f)
+            return start>=-h && start<=h;
+
+        const float inverse = 1.0f / direction;
+
+        float a = (-h - start) * inverse;
+        float b = (h - start) * inverse;
+
+        if (a>b)
+        {
+            const float swap = a;
+            a = b;
+            b = swap;
+        }
+
+        if (a>enter)
+            enter = a;
+
+        if (b<exit)
+            exit = b;
+
+        return enter<=exit;
+    }
+
+    /// Body transforms for a single tick.
+
+    struct Frame
+    {
+        unsigned int time;
+        bool valid;
+        std::vector<Record> records;
+    };
+
+    std::vector<Frame> frames;          ///< recorded frames indexed by time modulo size.
+    unsigned int newest;                ///< most recent time recorded.
+    Frame *recording;                   ///< frame currently being recorded.
+};
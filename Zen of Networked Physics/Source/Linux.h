@@ -0,0 +1,262 @@
+// Simple Linux OpenGL framework
+
+#if defined(__linux__) && !defined(HEADLESS)
+
+// X11 declares a Font type which clashes with our font manager
+
+#define Font XFont
+
+#include <X11/Xlib.h>
+#include <X11/Xutil.h>
+#include <X11/XKBlib.h>
+#include <X11/keysym.h>
+
+#include <GL/gl.h>
+#include <GL/glu.h>
+#include <GL/glx.h>
+
+#undef Font
+
+#include <string.h>
+#include <time.h>
+
+Display *display = 0;
+Window window = 0;
+GLXContext context = 0;
+Atom closeMessage = 0;
+
+int displayWidth = 0;
+int displayHeight = 0;
+bool displayFullscreen = false;
+
+GLuint fontBase = 0;
+
+/// Map an X11 key event to our key enum.
+/// @returns false if the key is not one we care about.
+
+bool translateKey(XKeyEvent &event, Key &key)
+{
+    switch (XLookupKeysym(&event, 0))
+    {
+        case XK_Left:       key = Left;      return true;
+        case XK_Right:      key = Right;     return true;
+        case XK_Up:         key = Up;        return true;
+        case XK_Down:       key = Down;      return true;
+        case XK_space:      key = Space;     return true;
+        case XK_Return:     key = Enter;     return true;
+        case XK_Control_L:  key = Control;   return true;
+        case XK_Control_R:  key = Control;   return true;
+        case XK_Escape:     key = Esc;       return true;
+        case XK_Page_Up:    key = PageUp;    return true;
+        case XK_Page_Down:  key = PageDown;  return true;
+        case XK_F1:         key = F1;        return true;
+        case XK_F2:         key = F2;        return true;
+        case XK_F3:         key = F3;        return true;
+        case XK_F4:         key = F4;        return true;
+        case XK_F5:         key = F5;        return true;
+        case XK_F6:         key = F6;        return true;
+        case XK_F7:         key = F7;        return true;
+        case XK_F8:         key = F8;        return true;
+        case XK_F9:         key = F9;        return true;
+        case XK_F10:        key = F10;       return true;
+    }
+
+    return false;
+}
+
+bool openDisplay(const char title[], int width, int height, bool fullscreen)
+{
+    displayWidth = width;
+    displayHeight = height;
+    displayFullscreen = fullscreen;
+
+    display = XOpenDisplay(0);
+    if (!display)
+        return false;
+
+    // report key repeat as repeated key down without key up, matching windows
+
+    XkbSetDetectableAutoRepeat(display, True, 0);
+
+    // choose visual
+
+    int attributes[] = { GLX_RGBA, GLX_DOUBLEBUFFER, GLX_DEPTH_SIZE, 16, GLX_STENCIL_SIZE, 8, None };
+
+    XVisualInfo *visual = glXChooseVisual(display, DefaultScreen(display), attributes);
+    if (!visual)
+        return false;
+
+    // create window
+
+    Window root = RootWindow(display, visual->screen);
+
+    XSetWindowAttributes windowAttributes;
+    memset(&windowAttributes, 0, sizeof(windowAttributes));
+    windowAttributes.colormap = XCreateColormap(display, root, visual->visual, AllocNone);
+    windowAttributes.event_mask = KeyPressMask | KeyReleaseMask | StructureNotifyMask;
+
+    // fullscreen windows bypass the window manager and cover the top left of the screen.
+    // note: unlike windows the display mode is not changed
+
+    windowAttributes.override_redirect = fullscreen ? True : False;
+
+    int x = 0;
+    int y = 0;
+
+    if (!fullscreen)
+    {
+        x = (DisplayWidth(display, visual->screen) - width) >> 1;
+        y = (DisplayHeight(display, visual->screen) - height) >> 1;
+    }
+
+    window = XCreateWindow( display, root, x, y, width, height, 0,
+                            visual->depth, InputOutput, visual->visual,
+                            CWColormap | CWEventMask | CWOverrideRedirect, &windowAttributes );
+
+    if (!window)
+    {
+        XFree(visual);
+        return false;
+    }
+
+    XStoreName(display, window, title);
+
+    // window is not resizable
+
+    XSizeHints hints;
+    memset(&hints, 0, sizeof(hints));
+    hints.flags = PMinSize | PMaxSize;
+    hints.min_width = hints.max_width = width;
+    hints.min_height = hints.max_height = height;
+    XSetWMNormalHints(display, window, &hints);
+
+    // ask to be notified when the window is closed
+
+    closeMessage = XInternAtom(display, "WM_DELETE_WINDOW", False);
+    XSetWMProtocols(display, window, &closeMessage, 1);
+
+    // initialize glx
+
+    context = glXCreateContext(display, visual, 0, True);
+
+    XFree(visual);
+
+    if (!context)
+        return false;
+
+    if (!glXMakeCurrent(display, window, context))
+        return false;
+
+    // build font
+
+    fontBase = glGenLists(96);
+
+    XFontStruct *font = XLoadQueryFont(display, "-*-courier-bold-r-normal--24-*-*-*-*-*-*-*");
+
+    if (!font)
+        font = XLoadQueryFont(display, "fixed");
+
+    if (font)
+    {
+        glXUseXFont(font->fid, 32, 96, fontBase);
+        XFreeFont(display, font);
+    }
+
+    // show window
+
+    XMapRaised(display, window);
+
+    if (fullscreen)
+        XGrabKeyboard(display, window, True, GrabModeAsync, GrabModeAsync, CurrentTime);
+
+    return true;
+}
+
+void updateDisplay()
+{
+    // show rendering
+
+    glXSwapBuffers(display, window);
+
+    // process pending events
+
+    while (XPending(display))
+    {
+        XEvent event;
+        XNextEvent(display, &event);
+
+        switch (event.type)
+        {
+            case KeyPress:
+            {
+                Key key;
+                if (translateKey(event.xkey, key))
+                    onKeyDown(key);
+            }
+            break;
+
+            case KeyRelease:
+            {
+                Key key;
+                if (translateKey(event.xkey, key))
+                    onKeyUp(key);
+            }
+            break;
+
+            case ClientMessage:
+                if ((Atom)event.xclient.data.l[0]==closeMessage)
+                    onQuit();
+                break;
+        }
+    }
+}
+
+void closeDisplay()
+{
+    glDeleteLists(fontBase, 96);
+
+    XUngrabKeyboard(display, CurrentTime);
+
+    glXMakeCurrent(display, None, 0);
+    glXDestroyContext(display, context);
+    context = 0;
+
+    XDestroyWindow(display, window);
+    window = 0;
+
+    XCloseDisplay(display);
+    display = 0;
+}
+
+unsigned long long nanoseconds()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+int atomicExchange(volatile int *value, int exchange)
+{
+    return __atomic_exchange_n(value, exchange, __ATOMIC_ACQ_REL);
+}
+
+int atomicLoad(volatile int *value)
+{
+    return __atomic_load_n(value, __ATOMIC_ACQUIRE);
+}
+
+void drawText(float x, float y, const char text[], Vector color, float alpha)
+{
+    // note: user is responsible for setting up screenspace matrices etc.
+
+    glColor4f(color.x, color.y, color.z, alpha);
+
+    glRasterPos2f(x, y);
+
+    glPushAttrib(GL_LIST_BIT);
+    glListBase(fontBase - 32);
+    glCallLists((GLsizei)strlen(text), GL_UNSIGNED_BYTE, text);
+    glPopAttrib();
+}
+
+#endif
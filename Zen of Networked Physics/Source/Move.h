@@ -1,8 +1,56 @@
 /// Move data.
+/// Only the primary physics state and the packed input are stored, secondary
+/// state is rebuilt on demand, keeping the history buffer compact.
 
 struct Move
 {
     unsigned int time;			///< integer time
-    Cube::State state;			///< cube physics state
-    Cube::Input input;			///< cube input
+    Vector position;            ///< cube position
+    Quaternion orientation;     ///< cube orientation
+    Vector momentum;            ///< cube momentum
+    Vector angularMomentum;     ///< cube angular momentum
+    unsigned char buttons;      ///< cube input packed with Cube::Input::pack
+
+    /// store the primary quantities of a physics state
+
+    void store(const Cube::State &state)
+    {
+        position = state.position;
+        orientation = state.orientation;
+        momentum = state.momentum;
+        angularMomentum = state.angularMomentum;
+    }
+
+    /// check if the stored primary quantities match a physics state exactly
+
+    bool matches(const Cube::State &state) const
+    {
+        return position==state.position && orientation==state.orientation &&
+            momentum==state.momentum && angularMomentum==state.angularMomentum;
+    }
+
+    /// body to world matrix, all that is needed to render the move
+
+    Matrix transform() const
+    {
+        Matrix translation;
+        translation.translate(position);
+        return translation * orientation.matrix();
+    }
+
+    /// set cube input
+
+    void setInput(const Cube::Input &input)
+    {
+        buttons = (unsigned char) input.pack();
+    }
+
+    /// get cube input
+
+    Cube::Input input() const
+    {
+        Cube::Input input;
+        input.unpack(buttons);
+        return input;
+    }
 };
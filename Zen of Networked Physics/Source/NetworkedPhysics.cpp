@@ -3,8 +3,17 @@
 // http://www.gaffer.org/articles
 
 //#define LOGGING
+//#define ADAPTIVE_INTEGRATION
+//#define PROXY_INTERPOLATION
+//#define PROXY_DEAD_RECKONING
 #define DEVELOPMENT
 
+// run the simulation on its own thread where C++11 threads are available (not VS2005)
+
+#if !defined(_MSC_VER) || _MSC_VER>=1700
+#define THREADED_SIMULATION
+#endif
+
 #pragma warning( disable : 4127 )  // conditional expression is constant
 #pragma warning( disable : 4100 )  // unreferenced formal parameter
 #pragma warning( disable : 4702 )  // unreachable code
@@ -26,7 +35,9 @@ bool openDisplay(const char title[], int width, int height, bool fullscreen = fa
 void updateDisplay();
 void closeDisplay();
 void drawText(float x, float y, const char text[], Vector color = Vector(1,1,1), float alpha = 1);
-float time();
+unsigned long long nanoseconds();
+int atomicExchange(volatile int *value, int exchange);
+int atomicLoad(volatile int *value);
 
 enum Key 
 { 
@@ -49,6 +60,7 @@ enum Key
     F7,
     F8,
     F9,
+    F10,
 };
 
 void onKeyUp(Key key);
@@ -56,9 +68,12 @@ void onKeyDown(Key key);
 void onQuit();
 
 #include <vector>
-#include <queue>
+#include <algorithm>
 #include "Apple.h"
 #include "Windows.h"
+#include "Linux.h"
+#include "Headless.h"
+#include "Scheduler.h"
 
 // platform independent
 
@@ -68,12 +83,30 @@ void onQuit();
 Font font;
 
 #include "Plane.h"
+#include "Image.h"
 #include "OpenGL.h"
+#include "RingBuffer.h"
+#include "Trace.h"
+
+Trace trace;
+
+#include "Profiler.h"
+
+Profiler profiler;
+
 #include "Cube.h"
-#include "Scene.h"
+#include "CubeRenderer.h"
+#include "TripleBuffer.h"
 #include "Move.h"
+#include "Snapshot.h"
+#include "Scene.h"
+#include "InputWindow.h"
 #include "History.h"
 #include "Client.h"
+#include "Relevancy.h"
+#include "JitterBuffer.h"
+#include "DeadReckoning.h"
+#include "LagCompensation.h"
 #include "Server.h"
 #include "Proxy.h"
 #include "Text.h"
@@ -105,6 +138,19 @@ void onQuit()
 	quit = true;
 }
 
+/// Controls handed from the main thread to the simulation thread.
+
+struct Controls
+{
+    Cube::Input input;              ///< client input.
+    float latency;                  ///< connection latency each way in seconds.
+    float packetLoss;               ///< connection packet loss percentage.
+    bool redundantInput;            ///< true if the server uses redundant input.
+    unsigned int snaps;             ///< number of server snaps requested.
+};
+
+TripleBuffer<Controls> controls;
+
 // options manager
 
 #include "Options.h"
@@ -112,6 +158,246 @@ void onQuit()
 Options options;
 
 
+/// Simulation stepped by the fixed timestep scheduler on its worker thread.
+/// Reads only the controls published by the main thread and publishes a
+/// snapshot of the scenes for rendering at the end of each tick.
+
+struct Simulation : public Scheduler::Simulation
+{
+    Simulation()
+    {
+        snaps = 0;
+    }
+
+    void step(unsigned int t, float /*dt*/)
+    {
+        const unsigned long long start = nanoseconds();
+
+        // apply latest controls
+
+        controls.update();
+
+        const Controls &current = controls.read();
+
+        client.input = current.input;
+
+        connection.latency = current.latency;
+        connection.packetLoss = current.packetLoss;
+
+        server.useRedundantInput = current.redundantInput;
+
+        for (; snaps!=current.snaps; snaps++)
+            server.snap();
+
+        // update connection
+
+        connection.update(t);
+
+        // update scenes
+
+        client.update(t);
+        proxy.update(t);
+
+        // end tick for profiling
+
+        profiler.sample(Profiler::Simulation);
+
+        // publish for rendering
+
+        view.publish(t+1);
+
+        trace.complete("tick", Profiler::Simulation, start, nanoseconds(), "t", t);
+    }
+
+private:
+
+    unsigned int snaps;             ///< number of server snaps done.
+};
+
+Simulation simulation;
+
+Scheduler scheduler(timestep);
+
+/// Publish the current input and options to the simulation.
+
+void publish()
+{
+    Controls &next = controls.write();
+
+    next.input.left = input.left();
+    next.input.right = input.right();
+    next.input.forward = input.up();
+    next.input.back = input.down();
+    next.input.jump = input.space();
+
+    options.update(next);
+
+    controls.publish();
+}
+
+#ifdef HEADLESS
+
+/// Press and release keys at fixed ticks so every offscreen run is identical.
+/// Once the cube has dropped onto the ground it moves left, forward, right and
+/// back, jumping along the way. The script repeats every thousand ticks so long
+/// soak runs keep exercising the network code.
+
+void script(unsigned int t)
+{
+    struct Event { unsigned int time; Key key; bool down; };
+
+    static const Event events[] =
+    {
+        { 500, Left, true },    { 540, Left, false },
+        { 530, Up, true },      { 570, Up, false },
+        { 600, Space, true },   { 610, Space, false },
+        { 620, Right, true },   { 670, Right, false },
+        { 680, Down, true },    { 740, Down, false },
+        { 760, Space, true },   { 770, Space, false },
+    };
+
+    for (unsigned int i=0; i<sizeof(events)/sizeof(events[0]); i++)
+    {
+        if (events[i].time==t%1000)
+        {
+            if (events[i].down)
+                onKeyDown(events[i].key);
+            else
+                onKeyUp(events[i].key);
+        }
+    }
+}
+
+/// Offscreen mode for visual regression testing on machines without a display.
+/// Steps the simulation on this thread following a fixed input script, with
+/// every view element shown and simulated latency and packet loss, then renders
+/// the frame at the requested tick into a PPM image. Compare images with Compare.cpp.
+/// If a profile file is given every tick is rendered, and the profiler report is
+/// written to it as JSON. If a trace file is given, timed calls and network events
+/// are written to it in Chrome trace format. Pass - to skip the profile.
+/// Usage: NetworkedPhysics <tick> <image.ppm> [profile.json|-] [trace.json]
+
+int main(int argc, char *argv[])
+{
+    if (argc<3)
+    {
+        printf("usage: %s tick image.ppm [profile.json|-] [trace.json]\n", argv[0]);
+        return 1;
+    }
+
+    const unsigned int tick = (unsigned int) atoi(argv[1]);
+
+    const bool profiling = argc>3 && strcmp(argv[3], "-")!=0;
+
+    // packet loss is random, seed it so runs match
+
+    srand(1);
+
+    if (!openDisplay("Zen of Networked Physics", 800, 600, false))
+    {
+        printf("could not open offscreen display\n");
+        return 1;
+    }
+
+	initializeOpenGL();
+	
+    view.initialize(client, server, proxy);
+    connection.initialize(client, server, proxy);
+
+    try
+    {
+	    font.initialize();
+    }
+    catch (std::exception &e)
+    {
+        printf("%s, rendering without text\n", e.what());
+    }
+
+    input.listener = &options;
+
+    if (argc>4)
+    {
+        if (!trace.open(argv[4]))
+        {
+            printf("could not write %s\n", argv[4]);
+            return 1;
+        }
+
+        profiler.trace = &trace;
+    }
+
+    options.renderServer = true;
+    options.renderProxy = true;
+    options.renderHistory = true;
+    options.renderSmoothedClient = true;
+    options.renderSmoothedProxy = true;
+    options.latency = Options::TwoHundredMillisecondsLatency;
+    options.packetLoss = Options::FivePercentPacketLoss;
+
+    // step simulation up to the tick, publishing controls each tick as the main loop does
+
+    for (unsigned int t=0; t<tick; t++)
+    {
+        script(t);
+
+        input.update(t);
+        view.update(t);
+
+        publish();
+
+        simulation.step(t, timestep);
+
+        if (profiling)
+        {
+            view.receive();
+            view.render(1.0f);
+
+            profiler.sample(Profiler::Render);
+
+            updateDisplay();
+        }
+    }
+
+    publish();
+
+    // render the tick and save it
+
+    view.receive();
+    view.render(1.0f);
+
+    Image image;
+    captureImage(image);
+
+    closeDisplay();
+
+    trace.close();
+
+    if (!image.write(argv[2]))
+    {
+        printf("could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    // save profile
+
+    if (profiling)
+    {
+        Profiler::Report report = view.snapshot().profile;
+
+        profiler.report(Profiler::Render, report);
+
+        if (!report.write(argv[3]))
+        {
+            printf("could not write %s\n", argv[3]);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+#else
+
 int main()
 {
 	const int width = 800;
@@ -133,67 +419,57 @@ int main()
 
     input.listener = &options;
 
-	unsigned int t = 0;
-    float accumulator = 0.0f;
+    // run simulation on its own thread
+
+    unsigned int t = 0;
+
+    publish();
+
+    #ifdef THREADED_SIMULATION
+    scheduler.start(simulation);
+    #endif
 
-    float absoluteTime = 0.0f;
-    
     while (!quit) 
 	{			
-        // update absolute time
-
-        float newTime = time();
-        float deltaTime = newTime - absoluteTime;
+        // otherwise step the simulation here
 
-        if (deltaTime<=0.0f)
-            continue;
+        if (!scheduler.threaded())
+            scheduler.update(simulation);
 
-        options.update(absoluteTime, deltaTime);
+        // pick up the latest simulation tick
 
-        absoluteTime = newTime;
+        view.receive();
 
-		accumulator += deltaTime;
+        const Snapshot &snapshot = view.snapshot();
 
-        // update discrete time
+        // update input, options and view once per simulation tick
 
-        while (accumulator>=timestep)
+        for (; t<snapshot.time; t++)
         {
-            // update input
-
             input.update(t);
-
-            client.input.left = input.left();
-            client.input.right = input.right();
-            client.input.forward = input.up();
-            client.input.back = input.down();
-            client.input.jump = input.space();
-
-            // update connection
-
-            connection.update(t);
-
-            // update scenes
-
-            client.update(t);
-            proxy.update(t);
             view.update(t);
-
-            // advance discrete time
-
-            accumulator -= timestep;
-            t++;
         }
 
+        publish();
+
         // render view
 
-        view.render(accumulator/timestep);
+        view.render(scheduler.alpha(snapshot.clock));
+
+        profiler.sample(Profiler::Render);
 
         // update display
 
         updateDisplay();
 	}
+
+    #ifdef THREADED_SIMULATION
+    scheduler.stop();
+    #endif
 	
 	closeDisplay();
 	
 	return 0;
 }
+
+#endif
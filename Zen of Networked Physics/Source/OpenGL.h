@@ -62,7 +62,7 @@ void calculateFrustumPlanes(Plane &left, Plane &right, Plane &bottom, Plane &top
 	bottom.normal.x = clip(0,3) + clip(0,1);
 	bottom.normal.y = clip(1,3) + clip(1,1);
 	bottom.normal.z = clip(2,3) + clip(2,1);
-	bottom.constant = - clip(3,3) + clip(3,1);
+	bottom.constant = - (clip(3,3) + clip(3,1));
 	bottom.normalize();
 	
 	top.normal.x = clip(0,3) - clip(0,1);
@@ -84,6 +84,88 @@ void calculateFrustumPlanes(Plane &left, Plane &right, Plane &bottom, Plane &top
 	back.normalize();
 }
 
+/// View frustum used to cull bodies before they are submitted for rendering.
+/// The planes point inwards, a point p is inside a plane if p.normal - constant >= 0.
+
+struct Frustum
+{
+    Plane planes[6];            ///< left, right, bottom, top, near and far planes.
+    Vector eye;                 ///< camera position in world space.
+
+    /// Calculate the frustum from the current OpenGL projection and modelview.
+
+    void calculate()
+    {
+        calculateFrustumPlanes(planes[0], planes[1], planes[2], planes[3], planes[4], planes[5]);
+
+        // camera position is the inverse rotation of the negated modelview translation
+
+        float m[16];
+        glGetFloatv(GL_MODELVIEW_MATRIX, m);
+
+        eye.x = - (m[0]*m[12] + m[1]*m[13] + m[2]*m[14]);
+        eye.y = - (m[4]*m[12] + m[5]*m[13] + m[6]*m[14]);
+        eye.z = - (m[8]*m[12] + m[9]*m[13] + m[10]*m[14]);
+    }
+
+    /// Check if a sphere is at least partly inside the frustum.
+    /// Conservative, some spheres just outside a corner are reported visible.
+
+    bool visible(const Vector &center, float radius) const
+    {
+        for (int i=0; i<6; i++)
+        {
+            if (center.dot(planes[i].normal) - planes[i].constant < -radius)
+                return false;
+        }
+
+        return true;
+    }
+
+    /// Check if a capsule, a sphere swept from a to b, is at least partly inside the frustum.
+
+    bool visible(const Vector &a, const Vector &b, float radius) const
+    {
+        for (int i=0; i<6; i++)
+        {
+            if (a.dot(planes[i].normal) - planes[i].constant < -radius &&
+                b.dot(planes[i].normal) - planes[i].constant < -radius)
+                return false;
+        }
+
+        return true;
+    }
+};
+
+/// Read the frame rendered so far into an image.
+
+void captureImage(Image &image)
+{
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+
+    image.resize(viewport[2], viewport[3]);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(viewport[0], viewport[1], viewport[2], viewport[3], GL_RGB, GL_UNSIGNED_BYTE, &image.pixels[0]);
+
+    // opengl rows start at the bottom, images start at the top
+
+    const int row = image.width * 3;
+
+    std::vector<unsigned char> swap(row);
+
+    for (int y=0; y<image.height/2; y++)
+    {
+        unsigned char *top = &image.pixels[y * row];
+        unsigned char *bottom = &image.pixels[(image.height - 1 - y) * row];
+
+        memcpy(&swap[0], top, row);
+        memcpy(top, bottom, row);
+        memcpy(bottom, &swap[0], row);
+    }
+}
+
 /// Enter screen space
 
 void enterScreenSpace()
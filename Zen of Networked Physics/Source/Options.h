@@ -26,7 +26,10 @@ struct Options : public Input::Listener
         #endif
     }
 
-    void update(float t, float dt)
+    /// update the view and fill in the controls for the simulation.
+    /// options never touch the simulation directly since it runs on another thread.
+
+    void update(Controls &controls)
     {
         // update visibility
 
@@ -36,25 +39,26 @@ struct Options : public Input::Listener
         view.renderHistory = renderHistory;
         view.renderSmoothedClient = renderSmoothedClient;
         view.renderSmoothedProxy = renderSmoothedProxy;
+        view.renderProfile = renderProfile;
 
         // handle latency controls
 
         switch (latency)
         {
             case NoLatency: 
-                connection.latency = 0.0f; 
+                controls.latency = 0.0f; 
                 break;
 
             case FiftyMillisecondsLatency: 
-                connection.latency = 50.0f/1000.0f * 0.5f; 
+                controls.latency = 50.0f/1000.0f * 0.5f; 
                 break;
 
             case TwoHundredMillisecondsLatency: 
-                connection.latency = 200.0f/1000.0f * 0.5f; 
+                controls.latency = 200.0f/1000.0f * 0.5f; 
                 break;
 
             case TwoSecondsLatency: 
-                connection.latency = 1.0f; 
+                controls.latency = 1.0f; 
                 break;
         }
 
@@ -63,25 +67,25 @@ struct Options : public Input::Listener
         switch (packetLoss)
         {
             case NoPacketLoss: 
-                connection.packetLoss = 0.0f; 
+                controls.packetLoss = 0.0f; 
                 break;
 
             case FivePercentPacketLoss: 
-                connection.packetLoss = 5.0f;
+                controls.packetLoss = 5.0f;
                 break;
 
             case TenPercentPacketLoss:
-                connection.packetLoss = 10.0f; 
+                controls.packetLoss = 10.0f; 
                 break;
 
             case FiftyPercentPacketLoss: 
-                connection.packetLoss = 50.0f; 
+                controls.packetLoss = 50.0f; 
                 break;
         }
 
         // update text visiblitiy
 
-        if (connection.packetLoss>0.0f || connection.latency>0.0f)
+        if (controls.packetLoss>0.0f || controls.latency>0.0f)
         {
             view.packetLoss.visible = true;
             view.latency.visible = true;
@@ -98,10 +102,10 @@ struct Options : public Input::Listener
         {
             char buffer[256];
 
-            if (connection.packetLoss<=10.0)
-                sprintf(buffer, "%d%% packet loss", (int) connection.packetLoss);
+            if (controls.packetLoss<=10.0)
+                sprintf(buffer, "%d%% packet loss", (int) controls.packetLoss);
             else
-                sprintf(buffer, "%d%% packet loss!", (int) connection.packetLoss);
+                sprintf(buffer, "%d%% packet loss!", (int) controls.packetLoss);
 
             view.packetLoss.text = buffer;
         }
@@ -110,7 +114,7 @@ struct Options : public Input::Listener
 
         if (view.latency.visible)
         {
-            const int milliseconds = (int) (connection.latency * 2.0f * 1000.0f);
+            const int milliseconds = (int) (controls.latency * 2.0f * 1000.0f);
 
             char buffer[256];
 
@@ -122,12 +126,15 @@ struct Options : public Input::Listener
             view.latency.text = buffer;
         }
 
-        // update important moves text output
+        // update redundant input text output
+
+        controls.redundantInput = redundantInput;
+        controls.snaps = snaps;
 
-        if (server.useImportantMoves && view.packetLoss.visible)
-            view.importantMoves.visible = true;
+        if (redundantInput && view.packetLoss.visible)
+            view.redundantInput.visible = true;
         else
-            view.importantMoves.visible = false;
+            view.redundantInput.visible = false;
     }
 
     void pressed(Key key)
@@ -183,11 +190,15 @@ struct Options : public Input::Listener
                 break;
 
             case F9:
-                server.useImportantMoves = !server.useImportantMoves;
+                redundantInput = !redundantInput;
+                break;
+
+            case F10:
+                renderProfile = !renderProfile;
                 break;
 
             case Control:
-                server.snap();
+                snaps++;
                 break;
 
             case Enter:
@@ -210,8 +221,13 @@ struct Options : public Input::Listener
         renderSmoothedClient = false;
         renderSmoothedProxy = false;
 
+        renderProfile = false;
+
         packetLoss = NoPacketLoss;
         latency = NoLatency;
+
+        redundantInput = false;
+        snaps = 0;
     }
 
     bool renderClient;
@@ -222,6 +238,8 @@ struct Options : public Input::Listener
     bool renderSmoothedClient;
     bool renderSmoothedProxy;
 
+    bool renderProfile;
+
     enum PacketLoss
     {
         NoPacketLoss,
@@ -244,6 +262,9 @@ struct Options : public Input::Listener
 
     int latency;
 
+    bool redundantInput;
+    unsigned int snaps;             ///< number of server snaps requested.
+
 private:
 
     FILE *logfile;
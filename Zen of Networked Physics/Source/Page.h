@@ -1,5 +1,8 @@
 /// Page.
 /// One page of the presentation: title and bullet point items.
+/// Items are laid out once, the first time the page is rendered after it is
+/// initialized, and their glyphs are gathered into a single array so all the
+/// items on a page are drawn together.
 
 struct Page
 {
@@ -15,6 +18,7 @@ struct Page
         x2 = 0.0f;
         y2 = 0.0f;
 		charactersPerLine = 0;
+		laidOut = false;
     }
 
     /// initialize page
@@ -28,6 +32,8 @@ struct Page
         this->y2 = y2;
 		this->charactersPerLine = charactersPerLine;
 
+		laidOut = false;
+
         // setup title text layout
 
 		const float titleHeight = 27;
@@ -80,22 +86,58 @@ struct Page
 
     void render(float parentAlpha = 1.0f)
     {
+		if (!laidOut)
+			layout();
+
         glScissor((int)x1, (int)y1, (int)(x2-x1), (int)(y2-y1));
 
+        titleText.render(parentAlpha);
+
+		// items share font, color and fade so they are drawn together
+
+		if (itemText.size() && itemText[0].font)
+		{
+			const Text &item = itemText[0];
+
+			const float alpha = item.alpha() * parentAlpha;
+
+			if (alpha>0.0001f)
+			{
+				glColor4f(item.r, item.g, item.b, alpha);
+				freetype::draw(*item.font, items);
+			}
+		}
+
+        glScissor(0, 0, displayWidth, displayHeight);
+    }
+
+private:
+
+	/// lay out items one after another with line breaks and gather their glyphs.
+
+	void layout()
+	{
 		const float horizontalSpacing = 12;
 		const float verticalSpacing = 18;
 
 		float offset = 0;
 
-        titleText.render(parentAlpha);
+		items.clear();
+
         for (unsigned int i=0; i<itemText.size(); i++)
-            offset += itemText[i].renderWithLineBreaks(charactersPerLine, offset, horizontalSpacing, verticalSpacing, parentAlpha) * verticalSpacing;
+		{
+            offset += itemText[i].layout(charactersPerLine, offset, horizontalSpacing, verticalSpacing) * verticalSpacing;
 
-        glScissor(0, 0, displayWidth, displayHeight);
-    }
+			const std::vector<float> &glyphs = itemText[i].glyphs();
+			items.insert(items.end(), glyphs.begin(), glyphs.end());
+		}
 
-private:
+		laidOut = true;
+	}
 
     Text titleText;
     std::vector<Text> itemText;
+
+	std::vector<float> items;	///< glyphs of all items, see freetype::layout
+	bool laidOut;				///< true once items are laid out
 };
@@ -58,12 +58,22 @@ struct Panel
 
     /// update panel
 
+    /// the fade settles exactly on the target so a hidden panel costs nothing to render.
+
     void update(unsigned int t)
     {
-        if (visible)
-            a += (opacity - a) * 0.05f;
-        else
-            a += (0.0f - a) * 0.1f;
+        const float target = visible ? opacity : 0.0f;
+
+        if (a!=target)
+        {
+            if (visible)
+                a += (opacity - a) * 0.05f;
+            else
+                a += (0.0f - a) * 0.1f;
+
+            if (fabs(a-target)<0.0001f)
+                a = target;
+        }
 
         for (unsigned int i=0; i<pages.size(); i++)
             pages[i].update(t);
@@ -136,7 +146,7 @@ private:
 
     void loadPages(const char filename[])
     {
-		const charactersPerLine = 41;
+		const int charactersPerLine = 41;
 
         pages.resize(0);
 
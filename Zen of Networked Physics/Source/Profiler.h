@@ -0,0 +1,252 @@
+/// Profiler.
+/// Scoped timers around the main stages of a simulation tick and a rendered
+/// frame. Time spent in a section is summed over each tick or frame, and the
+/// totals for the last Samples ticks or frames are kept for rolling median and
+/// 99th percentile times. Sections nest, so a section's time includes the time
+/// of any sections timed inside it.
+/// Each section belongs to either the simulation or the render thread, and each
+/// thread only samples and reports its own sections, so no locks are needed.
+/// The simulation hands its report to the renderer in the Snapshot.
+/// Every timed call can also be recorded to a Trace for viewing on a timeline.
+
+class Profiler
+{
+public:
+
+    /// Profiled sections.
+
+    enum Section
+    {
+        ConnectionUpdate,               ///< Connection::update, simulation thread.
+        ClientUpdate,                   ///< Client::update, simulation thread.
+        HistoryCorrection,              ///< History::correction, simulation thread.
+        ProxyUpdate,                    ///< Proxy::update, simulation thread.
+        CubeUpdate,                     ///< Cube::update with either integrator, simulation thread.
+        ViewRender,                     ///< View::render, render thread.
+        SectionCount
+    };
+
+    /// Threads sections are timed on.
+
+    enum Thread
+    {
+        Simulation,
+        Render
+    };
+
+    enum { Samples = 256 };             ///< ticks or frames kept for the rolling statistics.
+
+    /// Rolling statistics for a section.
+    /// Times are in milliseconds per tick or frame.
+
+    struct Statistics
+    {
+        int samples;                    ///< ticks or frames the statistics are taken over.
+        float p50;                      ///< median time.
+        float p99;                      ///< 99th percentile time.
+        float maximum;                  ///< slowest time.
+        float calls;                    ///< average number of calls.
+    };
+
+    /// Statistics for every section.
+
+    struct Report
+    {
+        Statistics sections[SectionCount];
+
+        Report()
+        {
+            memset(sections, 0, sizeof(sections));
+        }
+
+        /// Write the report as JSON.
+        /// @returns false if the file could not be written.
+
+        bool write(const char filename[]) const
+        {
+            FILE *file = fopen(filename, "w");
+
+            if (!file)
+                return false;
+
+            fprintf(file, "{\n    \"units\": \"milliseconds\",\n    \"sections\":\n    [\n");
+
+            for (int i=0; i<SectionCount; i++)
+            {
+                const Statistics &statistics = sections[i];
+
+                fprintf(file, "        { \"name\": \"%s\", \"thread\": \"%s\", \"samples\": %d, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f, \"calls\": %.2f }%s\n",
+                        name((Section)i), thread((Section)i)==Simulation ? "simulation" : "render",
+                        statistics.samples, statistics.p50, statistics.p99, statistics.maximum, statistics.calls,
+                        i<SectionCount-1 ? "," : "");
+            }
+
+            fprintf(file, "    ]\n}\n");
+
+            return fclose(file)==0;
+        }
+    };
+
+    /// Times the enclosing scope as a call to a section.
+
+    class Timer
+    {
+    public:
+
+        Timer(Profiler &profiler, Section section) : profiler(profiler), section(section)
+        {
+            start = nanoseconds();
+        }
+
+        ~Timer()
+        {
+            profiler.add(section, start, nanoseconds());
+        }
+
+    private:
+
+        Timer(const Timer &other);
+        Timer& operator=(const Timer &other);
+
+        Profiler &profiler;
+        Section section;
+        unsigned long long start;
+    };
+
+    Trace *trace;                       ///< if non-null every timed call is recorded here.
+
+    Profiler()
+    {
+        trace = 0;
+
+        history.assign(SectionCount, RingBuffer<Sample>(Samples, RingBuffer<Sample>::DropOldest));
+
+        for (int i=0; i<SectionCount; i++)
+        {
+            current[i].time = 0;
+            current[i].calls = 0;
+        }
+    }
+
+    /// Name of a section.
+
+    static const char* name(Section section)
+    {
+        static const char *names[SectionCount] =
+        {
+            "Connection::update",
+            "Client::update",
+            "History::correction",
+            "Proxy::update",
+            "Cube::update",
+            "View::render"
+        };
+
+        return names[section];
+    }
+
+    /// Thread a section is timed on.
+
+    static Thread thread(Section section)
+    {
+        return section==ViewRender ? Render : Simulation;
+    }
+
+    /// Add a call to a section in the current tick or frame.
+
+    void add(Section section, unsigned long long start, unsigned long long finish)
+    {
+        current[section].time += finish - start;
+        current[section].calls++;
+
+        if (trace)
+            trace->complete(name(section), thread(section), start, finish);
+    }
+
+    /// End the current tick or frame for the sections of a thread,
+    /// adding their totals to the rolling history.
+
+    void sample(Thread thread)
+    {
+        for (int i=0; i<SectionCount; i++)
+        {
+            if (Profiler::thread((Section)i)!=thread)
+                continue;
+
+            Sample sample;
+            sample.milliseconds = current[i].time / 1000000.0f;
+            sample.calls = current[i].calls;
+
+            history[i].add(sample);
+
+            current[i].time = 0;
+            current[i].calls = 0;
+        }
+    }
+
+    /// Calculate statistics over the rolling history for the sections of a thread.
+    /// Sections of other threads in the report are left unchanged.
+
+    void report(Thread thread, Report &report)
+    {
+        for (int i=0; i<SectionCount; i++)
+        {
+            if (Profiler::thread((Section)i)!=thread)
+                continue;
+
+            const RingBuffer<Sample> &samples = history[i];
+
+            Statistics &statistics = report.sections[i];
+
+            memset(&statistics, 0, sizeof(statistics));
+
+            statistics.samples = samples.size();
+
+            if (samples.empty())
+                continue;
+
+            float times[Samples];
+
+            int n = 0;
+            int calls = 0;
+
+            for (unsigned int index=samples.tail(); index!=samples.head(); index++)
+            {
+                times[n++] = samples[index].milliseconds;
+                calls += samples[index].calls;
+            }
+
+            std::nth_element(times, times + n/2, times + n);
+            statistics.p50 = times[n/2];
+
+            std::nth_element(times, times + n*99/100, times + n);
+            statistics.p99 = times[n*99/100];
+
+            statistics.maximum = *std::max_element(times + n*99/100, times + n);
+
+            statistics.calls = calls / (float) n;
+        }
+    }
+
+private:
+
+    /// Section totals for one tick or frame.
+
+    struct Sample
+    {
+        float milliseconds;
+        int calls;
+    };
+
+    /// Section totals accumulated so far this tick or frame.
+
+    struct Accumulator
+    {
+        unsigned long long time;        ///< nanoseconds.
+        int calls;
+    };
+
+    Accumulator current[SectionCount];
+
+    std::vector< RingBuffer<Sample> > history;     ///< totals for the last Samples ticks or frames per section, oldest dropped first.
+};
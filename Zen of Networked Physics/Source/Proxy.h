@@ -6,10 +6,28 @@
 /// event is recevied from the server, the state and input is snapped to the values
 /// sent from the server. Smoothing is used to even out snaps and pops caused by
 /// packet loss.
+/// Alternatively the proxy can buffer the states received from the server and
+/// interpolate between them a fixed delay in the past. This shows remote bodies
+/// slightly further behind but needs no physics integration at all on the proxy.
+/// Dead reckoning mode extrapolates with a cheap closed form prediction, only
+/// simulating full physics when contact is predicted. The server mirrors the
+/// prediction and only sends updates when its error exceeds the budget.
 /// Press F3 while running to toggle visualization of the proxy cube.
 
 struct Proxy : public Scene
 {
+    /// Method used to move the proxy between synchronize events.
+
+    enum Mode
+    {
+        Extrapolation,                  ///< simulate physics from the last state received, snapping when it differs.
+        Interpolation,                  ///< interpolate between buffered states received, delayed by interpolationDelay.
+        DeadReckoning                   ///< predict from the last state received, see DeadReckoning.
+    };
+
+    Mode mode;                          ///< current proxy mode.
+    float interpolationDelay;           ///< how far in the past to interpolate in seconds.
+
     /// default constructor.
 
     Proxy()
@@ -24,6 +42,16 @@ struct Proxy : public Scene
 
         lastSyncTime = 0;
         updating = false;
+
+        #if defined(PROXY_INTERPOLATION)
+        mode = Interpolation;
+        #elif defined(PROXY_DEAD_RECKONING)
+        mode = DeadReckoning;
+        #else
+        mode = Extrapolation;
+        #endif
+
+        interpolationDelay = 0.1f;
     }
 
 	/// synchronize event sent from server back to client
@@ -40,12 +68,29 @@ struct Proxy : public Scene
 
         this->input = input;
 
+        if (mode==Interpolation)
+        {
+            buffer(t, state);
+            return;
+        }
+
+        if (mode==DeadReckoning)
+        {
+            const Cube::State original = cube.state();
+            reckoning.reset(t, state, input);
+            cube.snap(state);
+            smooth(original);
+            time = t;
+            return;
+        }
+
         // correct if significantly different
 
         if (state.compare(cube.state()))
         {
+            const Cube::State original = cube.state();
             cube.snap(state);
-            smooth();
+            smooth(original);
         }
     }
 
@@ -55,12 +100,95 @@ struct Proxy : public Scene
 
     void update(unsigned int t)
     {
-        if (updating)
+        Profiler::Timer timer(profiler, Profiler::ProxyUpdate);
+
+        if (!updating)
+            return;
+
+        if (mode==Interpolation)
+            interpolate();
+        else if (mode==DeadReckoning)
+            reckon();
+        else
             Scene::update(t);
     }
 
 private:
 
+    /// advance the dead reckoning prediction by one tick
+
+    void reckon()
+    {
+        time ++;
+
+        const Cube::State &state = reckoning.predict(time, planes);
+
+        cube.set(state);
+    }
+
+    /// state received from the server
+
+    struct Snapshot
+    {
+        unsigned int time;
+        Cube::State state;
+    };
+
+    /// add a state received from the server to the interpolation buffer.
+    /// states no newer than the most recent buffered are dropped to keep the buffer in time order.
+
+    void buffer(unsigned int t, const Cube::State &state)
+    {
+        if (!snapshots.empty() && t<=snapshots.newest().time)
+            return;
+
+        // resync the proxy clock if it has drifted too far from the server
+
+        const float delay = interpolationDelay / timestep;
+
+        if (snapshots.empty() || fabs((float)time - (float)t) > delay + 1.0f)
+            time = t;
+
+        Snapshot snapshot;
+        snapshot.time = t;
+        snapshot.state = state;
+        snapshots.add(snapshot);
+    }
+
+    /// interpolate between buffered states at the current time minus the interpolation delay.
+    /// if no state has been received that late yet the most recent state is held.
+
+    void interpolate()
+    {
+        if (snapshots.empty())
+            return;
+
+        const float target = (float) time - interpolationDelay / timestep;
+
+        // discard states no longer needed
+
+        while (snapshots.size()>=2 && snapshots[snapshots.tail()+1].time<=target)
+            snapshots.remove();
+
+        const Snapshot &a = snapshots.oldest();
+
+        Cube::State state = a.state;
+
+        if (snapshots.size()>=2 && target>a.time)
+        {
+            const Snapshot &b = snapshots[snapshots.tail()+1];
+            const float alpha = (target - a.time) / (b.time - a.time);
+            state = Cube::interpolate(a.state, b.state, alpha);
+        }
+
+        cube.set(state);
+
+        time ++;
+    }
+
     unsigned int lastSyncTime;
     bool updating;
+
+    RingBuffer<Snapshot> snapshots;     ///< states received from the server in time order.
+    ::DeadReckoning reckoning;          ///< prediction used in dead reckoning mode.
 };
@@ -0,0 +1,245 @@
+/// Relevancy.
+/// Interest management deciding which server bodies are sent to each client.
+/// Bodies are binned into a uniform grid on the ground plane so a client only
+/// considers bodies in the cells around its own cube. Each client keeps a
+/// priority accumulator per body which grows every time the body is considered
+/// by an amount based on its distance from the client and its speed. Bodies are
+/// then selected highest accumulated priority first until the packet byte budget
+/// is spent. Sent bodies have their accumulator reset while unsent bodies keep
+/// accumulating, so every relevant body is eventually sent even under a tight
+/// budget.
+
+class Relevancy
+{
+public:
+
+    /// Body considered for sending.
+
+    struct Body
+    {
+        int id;                         ///< body id, must be small and non-negative as it indexes the priority accumulators.
+        Vector position;                ///< position of the body in world coordinates.
+        Vector velocity;                ///< velocity of the body in meters per second.
+    };
+
+    /// Per client relevancy state.
+
+    struct Client
+    {
+        Client()
+        {
+            body = -1;
+        }
+
+        int body;                       ///< id of the body controlled by this client, or -1 if none.
+        Vector position;                ///< position the client views the world from.
+        std::vector<float> priority;    ///< accumulated priority indexed by body id.
+    };
+
+    float cellSize;                     ///< size of each grid cell in meters.
+    float radius;                       ///< bodies further than this from the client are not relevant.
+    float distanceWeight;               ///< priority added per update for a body right next to the client, halved at the edge of the radius.
+    float velocityWeight;               ///< priority added per update per meter per second of body speed.
+    float ownerPriority;                ///< priority added per update for the body controlled by the client.
+    int bytesPerBody;                   ///< estimated size of a single body update in bytes.
+
+    /// Default constructor.
+
+    Relevancy()
+    {
+        cellSize = 10.0f;
+        radius = 50.0f;
+        distanceWeight = 1.0f;
+        velocityWeight = 0.1f;
+        ownerPriority = 1000.0f;
+        bytesPerBody = 64;
+    }
+
+    /// Rebuild the spatial grid from the current set of bodies.
+    /// Call once per server update before selecting bodies for clients.
+
+    void update(const std::vector<Body> &bodies)
+    {
+        this->bodies = bodies;
+
+        cells.resize(bodies.size());
+
+        for (unsigned int i=0; i<bodies.size(); i++)
+        {
+            cells[i].key = key(cell(bodies[i].position.x), cell(bodies[i].position.z));
+            cells[i].index = i;
+        }
+
+        std::sort(cells.begin(), cells.end());
+    }
+
+    /// Select bodies to send to a client.
+    /// Accumulates priority for all bodies relevant to the client then picks bodies
+    /// in order of decreasing accumulated priority until the byte budget is spent.
+    /// @param client the client to select bodies for.
+    /// @param budget maximum number of bytes of body updates to send.
+    /// @param selected receives the ids of the bodies to send.
+    /// @returns the number of bytes used.
+
+    int select(Client &client, int budget, std::vector<int> &selected)
+    {
+        selected.clear();
+
+        gather(client);
+
+        // accumulate priority for relevant bodies
+
+        for (unsigned int i=0; i<candidates.size(); i++)
+        {
+            const Body &body = bodies[candidates[i].index];
+
+            if (body.id>=(int)client.priority.size())
+                client.priority.resize(body.id+1, 0.0f);
+
+            client.priority[body.id] += priority(client, body);
+
+            candidates[i].priority = client.priority[body.id];
+        }
+
+        // pick highest priority bodies that fit in the budget
+
+        std::sort(candidates.begin(), candidates.end());
+
+        int bytes = 0;
+
+        for (unsigned int i=0; i<candidates.size(); i++)
+        {
+            if (bytes+bytesPerBody>budget)
+                break;
+
+            const int id = bodies[candidates[i].index].id;
+
+            selected.push_back(id);
+            client.priority[id] = 0.0f;
+            bytes += bytesPerBody;
+        }
+
+        return bytes;
+    }
+
+    /// Number of bodies relevant to the client in the last call to select,
+    /// whether or not they fit in the budget.
+
+    int relevant() const
+    {
+        return (int) candidates.size();
+    }
+
+    /// Calculate the priority added per update for a body relative to a client.
+
+    float priority(const Client &client, const Body &body) const
+    {
+        if (body.id==client.body)
+            return ownerPriority;
+
+        // falls off to half weight at the edge of the radius but never reaches zero,
+        // so distant bodies still accumulate enough priority to be sent eventually
+
+        const float distance = (body.position - client.position).length();
+
+        return distanceWeight * radius / (radius + distance) + velocityWeight * body.velocity.length();
+    }
+
+private:
+
+    /// Grid cell entry, sorted by cell key so that bodies in the same cell are adjacent.
+
+    struct Cell
+    {
+        unsigned int key;
+        unsigned int index;
+
+        bool operator<(const Cell &other) const
+        {
+            return key<other.key;
+        }
+    };
+
+    /// Candidate body for a client, sorted by decreasing accumulated priority.
+
+    struct Candidate
+    {
+        unsigned int index;
+        float priority;
+
+        bool operator<(const Candidate &other) const
+        {
+            return priority>other.priority;
+        }
+    };
+
+    /// Find all bodies within the relevancy radius of a client.
+    /// The body controlled by the client is always relevant.
+
+    void gather(const Client &client)
+    {
+        candidates.clear();
+
+        const int x1 = cell(client.position.x - radius);
+        const int x2 = cell(client.position.x + radius);
+        const int z1 = cell(client.position.z - radius);
+        const int z2 = cell(client.position.z + radius);
+
+        const float radiusSquared = radius * radius;
+
+        for (int x=x1; x<=x2; x++)
+        {
+            for (int z=z1; z<=z2; z++)
+            {
+                Cell target;
+                target.key = key(x,z);
+                target.index = 0;
+
+                std::vector<Cell>::const_iterator i = std::lower_bound(cells.begin(), cells.end(), target);
+
+                while (i!=cells.end() && i->key==target.key)
+                {
+                    const Body &body = bodies[i->index];
+
+                    if (body.id!=client.body && (body.position - client.position).lengthSquared()<=radiusSquared)
+                        add(i->index);
+
+                    ++i;
+                }
+            }
+        }
+
+        for (unsigned int i=0; i<bodies.size(); i++)
+        {
+            if (bodies[i].id==client.body)
+                add(i);
+        }
+    }
+
+    void add(unsigned int index)
+    {
+        Candidate candidate;
+        candidate.index = index;
+        candidate.priority = 0.0f;
+        candidates.push_back(candidate);
+    }
+
+    /// Grid cell coordinate for a world coordinate.
+
+    int cell(float value) const
+    {
+        return (int) Mathematics::floor(value / cellSize);
+    }
+
+    /// Pack grid cell coordinates into a single key.
+    /// Coordinates wrap every 65536 cells which is far larger than any scene.
+
+    static unsigned int key(int x, int z)
+    {
+        return ((unsigned int)(x & 0xFFFF) << 16) | (unsigned int)(z & 0xFFFF);
+    }
+
+    std::vector<Body> bodies;           ///< bodies registered at the last update.
+    std::vector<Cell> cells;            ///< grid cell entries sorted by key.
+    std::vector<Candidate> candidates;  ///< relevant bodies for the client being selected.
+};
@@ -0,0 +1,207 @@
+/// Ring buffer.
+/// A first in first out buffer with a power of two capacity. Head and tail are
+/// free running counters and elements are found by masking the counter, so
+/// stepping an index forward or back is a single add with no wrap checks, and
+/// an index stays valid even when the buffer grows.
+/// What happens when an element is added to a full buffer is set by the overflow
+/// policy, so the buffer never silently overwrites elements still in use.
+
+template <typename T> class RingBuffer
+{
+public:
+
+    /// What to do when adding to a full buffer.
+
+    enum Policy
+    {
+        Grow,                           ///< double the capacity.
+        DropOldest,                     ///< remove the oldest element to make room.
+        Reject                          ///< refuse the new element.
+    };
+
+    /// Ring buffer statistics.
+
+    struct Statistics
+    {
+        int highWater;                  ///< largest number of elements held at once.
+        unsigned int grown;             ///< number of times the capacity was doubled.
+        unsigned int dropped;           ///< elements removed to make room under DropOldest.
+        unsigned int rejected;          ///< elements refused under Reject.
+    };
+
+    /// Constructor.
+    /// @param capacity initial capacity, rounded up to a power of two.
+    /// @param policy overflow policy.
+
+    RingBuffer(int capacity = 16, Policy policy = Grow)
+    {
+        this->policy = policy;
+        resize(capacity);
+    }
+
+    /// Clear the buffer and set its capacity, rounded up to a power of two.
+
+    void resize(int capacity)
+    {
+        int size = 1;
+        while (size<capacity)
+            size <<= 1;
+
+        data.resize(size);
+        mask = size - 1;
+
+        clear();
+    }
+
+    /// Remove all elements and reset statistics.
+
+    void clear()
+    {
+        first = 0;
+        last = 0;
+
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// Add an element at the head of the buffer.
+    /// @returns false if the buffer was full and the element was rejected.
+
+    bool add(const T &value)
+    {
+        if (full())
+        {
+            if (policy==Reject)
+            {
+                statistics.rejected++;
+                return false;
+            }
+            else if (policy==DropOldest)
+            {
+                statistics.dropped++;
+                first++;
+            }
+            else
+            {
+                grow();
+            }
+        }
+
+        data[last & mask] = value;
+        last++;
+
+        if (size()>statistics.highWater)
+            statistics.highWater = size();
+
+        return true;
+    }
+
+    /// Remove the oldest element.
+
+    void remove()
+    {
+        assert(!empty());
+        first++;
+    }
+
+    T& oldest()
+    {
+        assert(!empty());
+        return data[first & mask];
+    }
+
+    T& newest()
+    {
+        assert(!empty());
+        return data[(last-1) & mask];
+    }
+
+    bool empty() const
+    {
+        return first==last;
+    }
+
+    bool full() const
+    {
+        return last-first>mask;
+    }
+
+    int size() const
+    {
+        return (int) (last - first);
+    }
+
+    int capacity() const
+    {
+        return (int) data.size();
+    }
+
+    /// Index of the oldest element.
+
+    unsigned int tail() const
+    {
+        return first;
+    }
+
+    /// Index one past the newest element.
+
+    unsigned int head() const
+    {
+        return last;
+    }
+
+    void next(unsigned int &index) const
+    {
+        index++;
+    }
+
+    void previous(unsigned int &index) const
+    {
+        index--;
+    }
+
+    /// Element at an index between tail and head.
+
+    T& operator[](unsigned int index)
+    {
+        assert(index-first<last-first);
+        return data[index & mask];
+    }
+
+    const T& operator[](unsigned int index) const
+    {
+        assert(index-first<last-first);
+        return data[index & mask];
+    }
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+private:
+
+    /// Double the capacity keeping every element at the same index.
+
+    void grow()
+    {
+        std::vector<T> larger(data.size() * 2);
+
+        const unsigned int largerMask = (unsigned int) larger.size() - 1;
+
+        for (unsigned int i=first; i!=last; i++)
+            larger[i & largerMask] = data[i & mask];
+
+        data.swap(larger);
+        mask = largerMask;
+
+        statistics.grown++;
+    }
+
+    std::vector<T> data;                ///< element storage, size is a power of two.
+    unsigned int mask;                  ///< capacity minus one.
+    unsigned int first;                 ///< index of the oldest element.
+    unsigned int last;                  ///< index one past the newest element.
+    Policy policy;                      ///< overflow policy.
+
+    Statistics statistics;
+};
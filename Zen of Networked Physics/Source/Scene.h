@@ -1,8 +1,11 @@
 /// Scene class.
 /// Represents the scene managing objects and collision geometry.
 
-const float defaultTightness = 0.25f;
-const float smoothTightness = 0.1f;
+const float smallError = 0.25f;              ///< errors below this distance decay slowly so small corrections are hidden.
+const float largeError = 4.0f;               ///< errors above this distance are snapped immediately.
+const float smallErrorDecay = 0.95f;         ///< fraction of a small error remaining after each tick.
+const float largeErrorDecay = 0.85f;         ///< fraction of a large error remaining after each tick.
+const float zeroError = 0.0001f;             ///< errors below this are cleared.
 
 struct Scene
 {
@@ -22,7 +25,12 @@ struct Scene
 
         logfile = 0;
         replaying = false;
-        tightness = defaultTightness;
+        smoothing = false;
+
+        positionError = Vector(0,0,0);
+        orientationError.identity();
+        previousPositionError = positionError;
+        previousOrientationError = orientationError;
 
         // start simulation at t=0
 
@@ -93,25 +101,64 @@ struct Scene
 
         cube.update(input, planes, timestep);
 
-        // update smoothed cube
-
-        if (!replaying)
-            smoothed.smooth(cube.state(), tightness);
+        // decay visual error
 
-        // update smoothing tightness value for adaptive smoothing
-
-        tightness += (defaultTightness - tightness) * 0.01f;
+        if (smoothing && !replaying)
+            decay();
 
         // advance t
 
         time ++;
     }
 
-    /// call this method when a snap occurs to smooooooth it out baby
+    /// call this method when a snap occurs to smooooooth it out baby.
+    /// the difference between where the cube was drawn before the snap and where it
+    /// is now becomes a visual error which is added back when rendering and decays
+    /// to zero over the following ticks. the physics state is never touched.
+    /// @param original the cube state before the snap.
 
-    void smooth()
+    void smooth(const Cube::State &original)
     {
-        tightness = smoothTightness;
+        const Cube::State &state = cube.state();
+
+        positionError += original.position - state.position;
+
+        Quaternion inverse;
+        state.orientation.conjugate(inverse);
+        orientationError = orientationError * original.orientation * inverse;
+        orientationError.normalize();
+
+        if (orientationError.w<0)
+            orientationError = -orientationError;
+
+        trace.instant("smooth", Profiler::Simulation, "error", positionError.length());
+
+        if (positionError.length()>largeError)
+            clear();
+        else
+            smoothing = true;
+
+        previousPositionError = positionError;
+        previousOrientationError = orientationError;
+    }
+
+    /// capture the smoothed cube, the cube with visual error applied, for rendering.
+    /// when there is no error this is the same as capturing the cube.
+
+    void capture(Snapshot::Body &body) const
+    {
+        body.capture(cube);
+
+        body.smoothing = smoothing;
+        body.previousPositionError = previousPositionError;
+        body.positionError = positionError;
+        body.previousOrientationError = previousOrientationError;
+        body.orientationError = orientationError;
+
+        body.r = smoothed.r;
+        body.g = smoothed.g;
+        body.b = smoothed.b;
+        body.a = smoothed.a;
     }
 
 public:
@@ -121,7 +168,7 @@ public:
 	Cube cube;                      ///< the cube object.
     Cube::Input input;              ///< current input for the cube.
 
-    Cube smoothed;                  ///< smoothed cube following main cube.
+    Cube smoothed;                  ///< cube used to render the smoothed view, only its appearance is used.
 
     std::vector<Plane> planes;      ///< the set of collision planes in the scene.
 
@@ -129,5 +176,48 @@ public:
 
     bool replaying;                 ///< true if currently replaying moves (client side correction)
 
-    float tightness;                ///< current smoothing tightness
+private:
+
+    /// decay the visual error towards zero.
+    /// small errors decay slowly so they are barely visible, larger errors faster.
+
+    void decay()
+    {
+        previousPositionError = positionError;
+        previousOrientationError = orientationError;
+
+        Quaternion identity;
+        identity.identity();
+
+        const float error = positionError.length() + (orientationError - identity).norm();
+
+        if (error<zeroError)
+        {
+            clear();
+            return;
+        }
+
+        const float factor = error<smallError ? smallErrorDecay : largeErrorDecay;
+
+        positionError *= factor;
+        orientationError = slerp(identity, orientationError, factor);
+    }
+
+    /// clear visual error.
+
+    void clear()
+    {
+        smoothing = false;
+        positionError = Vector(0,0,0);
+        orientationError.identity();
+        previousPositionError = positionError;
+        previousOrientationError = orientationError;
+    }
+
+    bool smoothing;                 ///< true while there is visual error to apply.
+
+    Vector positionError;           ///< visual position error added to the cube position.
+    Quaternion orientationError;    ///< visual orientation error applied to the cube orientation.
+    Vector previousPositionError;   ///< position error at the previous tick, for render interpolation.
+    Quaternion previousOrientationError;    ///< orientation error at the previous tick.
 };
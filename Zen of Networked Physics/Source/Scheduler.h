@@ -0,0 +1,400 @@
+/// Fixed timestep scheduler.
+///
+/// Accumulates real time between frames and steps a simulation forward in
+/// fixed sized ticks, leaving the remainder in the accumulator for the renderer
+/// to interpolate between the previous and current simulation state.
+///
+/// Real time per update is clamped to avoid the "spiral of death" when the
+/// simulation cannot keep up, and the number of catch up steps per update is
+/// limited. Time may be scaled for slow motion or fast forward.
+///
+/// When compiled with THREADED_SIMULATION the simulation may optionally be run
+/// on a worker thread so that a slow frame never stalls the physics tick. This
+/// needs the C++11 thread library. In this mode the renderer must either
+/// hold a Scheduler::Lock while reading the state the simulation copies out in
+/// Simulation::publish, or better, have the simulation publish what it needs
+/// each step through a lock free buffer so neither thread ever waits.
+/// See TripleBuffer and Snapshot.
+///
+/// Time is measured with the platform nanoseconds() clock and accumulated
+/// in integer nanoseconds so that precision does not degrade over long
+/// running sessions.
+
+#include <string.h>
+
+#ifdef THREADED_SIMULATION
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#endif
+
+class Scheduler
+{
+public:
+
+    /// Simulation interface stepped by the scheduler.
+
+    struct Simulation
+    {
+        virtual ~Simulation() {}
+
+        /// Advance the simulation by one fixed timestep.
+        /// On the worker thread this runs without the scheduler lock held.
+        /// @param tick the integer time being stepped from.
+        /// @param dt the fixed timestep in seconds.
+
+        virtual void step(unsigned int tick, float dt) = 0;
+
+        /// Copy out state read by other threads after a step.
+        /// Called while holding the scheduler lock, so keep it short.
+
+        virtual void publish() {}
+    };
+
+    /// Per step timing statistics.
+
+    struct Statistics
+    {
+        unsigned int frames;            ///< number of updates.
+        unsigned int steps;             ///< number of simulation steps taken.
+        unsigned int droppedSteps;      ///< number of steps discarded because the simulation could not keep up.
+        double droppedTime;             ///< seconds of simulation time discarded by clamping.
+        double frameTime;               ///< scaled real time in seconds accumulated in the last update.
+        int frameSteps;                 ///< steps taken during the last update.
+        double stepTime;                ///< wall clock seconds taken by the last step.
+        double averageStepTime;         ///< moving average of wall clock seconds per step.
+        double maximumStepTime;         ///< slowest step seen.
+    };
+
+    float timestep;                     ///< fixed simulation timestep in seconds.
+    float maximumFrameTime;             ///< real time per update is clamped to this many seconds.
+    int maximumSteps;                   ///< maximum catch up steps per update.
+    float timeScale;                    ///< scale applied to real time.
+
+    /// Constructor.
+    /// @param timestep the fixed simulation timestep in seconds.
+
+    Scheduler(float timestep = 0.01f)
+    {
+        this->timestep = timestep;
+        maximumFrameTime = 0.25f;
+        maximumSteps = 25;
+        timeScale = 1.0f;
+
+        tickCount = 0;
+        accumulator = 0;
+        previousTime = 0;
+        lastStepTime = 0;
+
+        #ifdef THREADED_SIMULATION
+        running = false;
+        #endif
+
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// Destructor.
+    /// Stops the worker thread if running.
+
+    ~Scheduler()
+    {
+        #ifdef THREADED_SIMULATION
+        stop();
+        #endif
+    }
+
+    /// Current value of the monotonic high resolution clock in nanoseconds.
+
+    static long long clock()
+    {
+        return (long long) nanoseconds();
+    }
+
+    /// Convert seconds to integer nanoseconds, rounding to nearest.
+
+    static long long toNanoseconds(double seconds)
+    {
+        return (long long) (seconds * 1000000000.0 + (seconds<0.0 ? -0.5 : 0.5));
+    }
+
+    /// Convert integer nanoseconds to seconds.
+
+    static double toSeconds(long long nanoseconds)
+    {
+        return nanoseconds / 1000000000.0;
+    }
+
+    /// Update the scheduler with the real time elapsed since the previous update
+    /// and step the simulation as many times as required.
+    /// @returns the number of steps taken.
+
+    int update(Simulation &simulation)
+    {
+        const long long currentTime = clock();
+
+        long long deltaTime = 0;
+
+        if (previousTime>0)
+            deltaTime = currentTime - previousTime;
+
+        previousTime = currentTime;
+
+        return update(simulation, deltaTime);
+    }
+
+    /// Update the scheduler with an explicit amount of real time.
+    /// @param deltaTime real time in nanoseconds since the previous update.
+    /// @returns the number of steps taken.
+
+    int update(Simulation &simulation, long long deltaTime)
+    {
+        const long long step = toNanoseconds(timestep);
+        const long long maximum = toNanoseconds(maximumFrameTime);
+
+        Guard lock(mutex);
+
+        // clamp real time to avoid the spiral of death
+
+        if (deltaTime<0)
+            deltaTime = 0;
+
+        if (deltaTime>maximum)
+        {
+            statistics.droppedTime += toSeconds(deltaTime - maximum) * timeScale;
+            deltaTime = maximum;
+        }
+
+        if (timeScale!=1.0f)
+            deltaTime = (long long) (deltaTime * (double) timeScale);
+
+        accumulator += deltaTime;
+
+        // step simulation, the lock is only held for bookkeeping and publishing
+
+        int steps = 0;
+
+        while (accumulator>=step && step>0 && steps<maximumSteps)
+        {
+            const unsigned int tick = tickCount;
+
+            lock.unlock();
+
+            const long long start = clock();
+
+            simulation.step(tick, timestep);
+
+            const long long finish = clock();
+
+            lock.lock();
+
+            simulation.publish();
+
+            accumulator -= step;
+            tickCount++;
+            steps++;
+
+            lastStepTime = finish;
+
+            statistics.stepTime = toSeconds(finish - start);
+            statistics.averageStepTime += (statistics.stepTime - statistics.averageStepTime) * 0.05;
+            if (statistics.stepTime>statistics.maximumStepTime)
+                statistics.maximumStepTime = statistics.stepTime;
+        }
+
+        // drop whole steps we could not catch up on
+
+        if (accumulator>=step && step>0)
+        {
+            const long long dropped = accumulator / step;
+            accumulator -= dropped * step;
+            statistics.droppedSteps += (unsigned int) dropped;
+            statistics.droppedTime += toSeconds(dropped * step);
+        }
+
+        statistics.frames++;
+        statistics.steps += steps;
+        statistics.frameSteps = steps;
+        statistics.frameTime = toSeconds(deltaTime);
+
+        return steps;
+    }
+
+    /// Interpolation alpha in [0,1] between the previous and current simulation state.
+    /// When running on a worker thread this is derived from the time since the last step
+    /// and must be called while holding a Scheduler::Lock.
+
+    float alpha() const
+    {
+        const double step = (double) toNanoseconds(timestep);
+
+        if (step<=0.0)
+            return 0.0f;
+
+        if (!threaded())
+            return (float) (accumulator / step);
+
+        return alpha(lastStepTime);
+    }
+
+    /// Interpolation alpha for a simulation state published by the worker thread.
+    /// Needs no Scheduler::Lock since only the time of the step is used.
+    /// @param stepTime clock time at the end of the step that produced the state.
+
+    float alpha(long long stepTime) const
+    {
+        const double step = (double) toNanoseconds(timestep);
+
+        if (step<=0.0)
+            return 0.0f;
+
+        const double elapsed = (clock() - stepTime) * (double) timeScale;
+        const double alpha = elapsed / step;
+        return alpha<1.0 ? (float) alpha : 1.0f;
+    }
+
+    /// Current integer simulation time.
+
+    unsigned int tick() const
+    {
+        return tickCount;
+    }
+
+    /// Current simulation time in seconds.
+
+    double time() const
+    {
+        return tickCount * (double) timestep;
+    }
+
+    /// Timing statistics.
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+    /// Reset timing statistics.
+
+    void resetStats()
+    {
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// True if the simulation is running on a worker thread.
+
+    bool threaded() const
+    {
+        #ifdef THREADED_SIMULATION
+        return running;
+        #else
+        return false;
+        #endif
+    }
+
+#ifdef THREADED_SIMULATION
+
+    /// Start running the simulation on a worker thread.
+    /// The worker steps the simulation on its own clock until stop is called.
+
+    void start(Simulation &simulation)
+    {
+        if (running)
+            return;
+
+        previousTime = 0;
+        running = true;
+
+        worker = std::thread(&Scheduler::run, this, &simulation);
+    }
+
+    /// Stop the worker thread.
+
+    void stop()
+    {
+        if (!running)
+            return;
+
+        running = false;
+
+        worker.join();
+    }
+
+    /// Scoped lock held while reading simulation state from another thread.
+    /// The worker thread holds the same lock only while publishing state after
+    /// each step and updating its timing, never for the step itself.
+
+    class Lock
+    {
+    public:
+
+        Lock(Scheduler &scheduler) : lock(scheduler.mutex) {}
+
+    private:
+
+        std::lock_guard<std::mutex> lock;
+    };
+
+#endif
+
+private:
+
+#ifdef THREADED_SIMULATION
+
+    typedef std::mutex Mutex;
+    typedef std::unique_lock<std::mutex> Guard;
+
+    /// Worker thread loop.
+
+    void run(Simulation *simulation)
+    {
+        while (running)
+        {
+            update(*simulation);
+
+            long long remaining;
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+
+                const long long step = toNanoseconds(timestep);
+
+                remaining = timeScale>0.0f ? (long long) ((step - accumulator) / (double) timeScale) : step;
+            }
+
+            // sleep until the next step is due
+
+            if (remaining>0)
+                std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+        }
+    }
+
+#else
+
+    /// Nothing to lock when single threaded.
+
+    struct Mutex {};
+
+    struct Guard
+    {
+        Guard(Mutex &) {}
+        void lock() {}
+        void unlock() {}
+    };
+
+#endif
+
+    unsigned int tickCount;             ///< current integer simulation time.
+    long long accumulator;              ///< nanoseconds of simulation time accumulated but not yet stepped.
+    long long previousTime;             ///< clock time of the previous update, zero before the first update.
+    long long lastStepTime;             ///< clock time of the last step, used for threaded interpolation.
+
+    Statistics statistics;
+
+    Mutex mutex;                        ///< guards scheduler timing and published simulation state.
+
+    #ifdef THREADED_SIMULATION
+    std::thread worker;                 ///< worker thread when running threaded.
+    std::atomic<bool> running;          ///< true while the worker thread is running.
+    #endif
+};
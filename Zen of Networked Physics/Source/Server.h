@@ -1,8 +1,11 @@
 /// Server.
 /// The authoritative scene on the server.
 /// The cube in this scene is driven by updates sent from the client
-/// containing current client time and input. The server then advances its own
-/// physics simulation ahead up to the most recent time sent from the client.
+/// containing client time and input. Input is buffered in a jitter buffer and
+/// the server advances its own physics simulation one tick per update, playing
+/// out the buffered input a few ticks behind the most recent time sent from
+/// the client.
+/// Each tick the body transforms are recorded for lag compensated hit queries.
 /// Press F2 to toggle visualization of the server cube.
 
 struct Server : public Scene
@@ -13,34 +16,81 @@ struct Server : public Scene
     {
         log("server.log");
         cube.a = 0.45f;
-        useImportantMoves = false;
+        useRedundantInput = false;
+        ack = 0;
     }
 
-    /// update server physics with input
+    /// receive a window of client input at local time t.
+    /// inputs for times already received are skipped by the jitter buffer, so each
+    /// input is processed once no matter how many packets it was sent in.
 
-    void update(unsigned int t, Cube::Input &input, const std::vector<Move> &importantMoves)
+    void receive(unsigned int t, const InputWindow &window)
     {
-        // work around packet loss with important moves
+        if (window.count==0)
+            return;
 
-        if (useImportantMoves)
+        // work around packet loss with redundant input, otherwise just take the most recent input
+
+        if (useRedundantInput)
+            jitter.insert(t, window);
+        else
+            jitter.insert(t, window.last(), window.get(window.count-1));
+
+        ack = jitter.received();
+    }
+
+    /// update server physics at local time t by playing out buffered input.
+
+    void update(unsigned int t)
+    {
+        const int ticks = jitter.ready();
+
+        for (int i=0; i<ticks; i++)
         {
-            for (unsigned int i=0; i<importantMoves.size(); i++)
-            {
-                const Move &move = importantMoves[i];
+            Cube::Input input;
+
+            const unsigned int inputTime = jitter.playout(input);
 
-                while (time<move.time)
-                    Scene::update(time);
+            // update to input time
 
-                this->input = move.input;
+            while (time<inputTime)
+            {
+                Scene::update(time);
+                record();
             }
+
+            this->input = input;
         }
 
-        // update to time t
+        ack = jitter.received();
+    }
 
-        while (time<t)
-            Scene::update(time);
+    /// get the bodies in the server scene for relevancy.
+    /// the server currently simulates a single cube with id 0.
 
-        this->input = input;
+    void bodies(std::vector<Relevancy::Body> &bodies) const
+    {
+        bodies.resize(1);
+        bodies[0].id = 0;
+        bodies[0].position = cube.state().position;
+        bodies[0].velocity = cube.state().velocity;
+    }
+
+    /// get the current state and input of a body.
+
+    void body(int id, Cube::State &state, Cube::Input &input) const
+    {
+        assert(id==0);
+        state = cube.state();
+        input = this->input;
+    }
+
+    /// record body transforms at the current time for lag compensation.
+
+    void record()
+    {
+        lag.begin(time);
+        lag.add(0, cube.state());
     }
 
     /// simulate a snap on the server for testing
@@ -55,7 +105,13 @@ struct Server : public Scene
             planes[i].clip(state.position, 0.5f);
 
         cube.snap(state);
+
+        trace.instant("server snap", Profiler::Simulation);
     }
 
-    bool useImportantMoves;         ///< if true then server will use important moves to work around packet loss.
+    bool useRedundantInput;         ///< if true then server will use redundant input to work around packet loss.
+    unsigned int ack;               ///< all client input before this time has been received or played out.
+
+    JitterBuffer jitter;            ///< buffers client input for steady playout.
+    LagCompensation lag;            ///< recent body transforms for lag compensated queries.
 };
@@ -0,0 +1,81 @@
+/// Render snapshot.
+/// Everything the view draws for one simulation tick. The simulation thread
+/// copies it out of the live scenes at the end of each tick and hands it to the
+/// renderer through a TripleBuffer, so rendering never reads simulation objects
+/// while they are being stepped on the other thread.
+
+struct Snapshot
+{
+    /// A cube as it should be drawn.
+    /// Holds the previous and current physics state for interpolation, and for
+    /// smoothed cubes the visual error at both ticks, see Scene::smooth.
+
+    struct Body
+    {
+        Cube::State previous;                   ///< physics state at the previous tick.
+        Cube::State current;                    ///< physics state at the captured tick.
+
+        bool smoothing;                         ///< true if there is visual error to apply.
+        Vector previousPositionError;           ///< visual position error at the previous tick.
+        Vector positionError;                   ///< visual position error at the captured tick.
+        Quaternion previousOrientationError;    ///< visual orientation error at the previous tick.
+        Quaternion orientationError;            ///< visual orientation error at the captured tick.
+
+        float r,g,b,a;                          ///< cube color.
+
+        /// Capture a cube with no visual error.
+
+        void capture(const Cube &cube)
+        {
+            previous = cube.previousState();
+            current = cube.state();
+            smoothing = false;
+            r = cube.r;
+            g = cube.g;
+            b = cube.b;
+            a = cube.a;
+        }
+
+        /// The state to draw interpolated between the previous and captured tick.
+
+        Cube::State interpolated(float alpha) const
+        {
+            Cube::State state = Cube::interpolate(previous, current, alpha);
+
+            if (smoothing)
+            {
+                state.position += previousPositionError + (positionError - previousPositionError) * alpha;
+                state.orientation = slerp(previousOrientationError, orientationError, alpha) * state.orientation;
+                state.recalculate();
+            }
+
+            return state;
+        }
+
+        /// Add the body to a cube renderer.
+
+        void render(CubeRenderer &renderer, float alpha) const
+        {
+            renderer.add(interpolated(alpha), r, g, b, a);
+        }
+    };
+
+    Snapshot()
+    {
+        time = 0;
+        clock = 0;
+    }
+
+    unsigned int time;                  ///< simulation time of the captured tick.
+    long long clock;                    ///< clock time the tick was captured, for render interpolation.
+
+    Body client;                        ///< client cube.
+    Body server;                        ///< server cube.
+    Body proxy;                         ///< proxy cube.
+    Body smoothedClient;                ///< client cube with visual error applied.
+    Body smoothedProxy;                 ///< proxy cube with visual error applied.
+
+    std::vector<Move> history;          ///< client move history, oldest first.
+
+    Profiler::Report profile;           ///< simulation thread profile, see Profiler::report.
+};
@@ -1,5 +1,8 @@
 /// Text element.
 /// Manages rendering text on the screen with alpha blend in/out
+/// The glyph quads for the text are laid out once and cached, and only laid
+/// out again when the text, font or position changes, so each frame the text
+/// costs a single draw call from the font's glyph atlas.
 
 struct Text
 {
@@ -27,13 +30,29 @@ struct Text
     }
 
     /// update text
+    /// the fade settles exactly on fully visible or invisible, so settled text costs nothing.
 
     void update(unsigned int t)
     {
+        const float target = visible ? 1.0f : 0.0f;
+
+        if (a==target)
+            return;
+
         if (visible)
             a += (1.0f - a) * 0.05f;
         else
             a += (0.0f - a) * 0.1f;
+
+        if (fabs(a-target)<0.0001f)
+            a = target;
+    }
+
+    /// current fade alpha
+
+    float alpha() const
+    {
+        return a;
     }
 
     /// render text
@@ -47,12 +66,49 @@ struct Text
         {
 			// render text normally
 
+			// no line breaks, cached as -1 characters per line
+
+			if (!cache.matches(*this, -1, 0, 0, 0))
+			{
+				cache.store(*this, -1, 0, 0, 0);
+				freetype::layout(*font, x, y, text.c_str(), cache.vertices);
+			}
+
 			glColor4f(r,g,b,a*parentAlpha);
-			freetype::print(*font, x, y, text.c_str());
+			freetype::draw(*font, cache.vertices);
         }
     }
 
+    /// lay out text with line breaks without rendering it.
+    /// the layout is cached and only redone when the text, font or layout parameters change.
+    /// @returns the number of line breaks.
+
+    int layout( int charactersPerLine,
+				float offset,
+				float horizonalSpacing,
+				float verticalSpacing )
+    {
+		if (!font)
+			return 0;
+
+		if (!cache.matches(*this, charactersPerLine, offset, horizonalSpacing, verticalSpacing))
+		{
+			cache.store(*this, charactersPerLine, offset, horizonalSpacing, verticalSpacing);
+			cache.lines = layoutWithLineBreaks(charactersPerLine, offset, horizonalSpacing, verticalSpacing);
+		}
+
+		return cache.lines;
+    }
+
+    /// glyph quads from the last layout, see freetype::layout.
+
+    const std::vector<float>& glyphs() const
+    {
+        return cache.vertices;
+    }
+
     /// render text with line breaks
+    /// @returns the number of line breaks, whether or not the text is visible.
 
     int renderWithLineBreaks( int charactersPerLine,
 							  float offset,
@@ -60,47 +116,110 @@ struct Text
 							  float verticalSpacing,
 							  float parentAlpha = 1.0f )
     {
-		if (!font)
-			return 0;
+		const int lines = layout(charactersPerLine, offset, horizonalSpacing, verticalSpacing);
+
+        if (font && a>0.0001f && parentAlpha>0.0001f)
+		{
+			glColor4f(r,g,b,a*parentAlpha);
+			freetype::draw(*font, cache.vertices);
+        }
+
+		return lines;
+    }
+
+private:
 
+	/// lay out words, breaking lines when they get too long.
+	/// @returns the number of line breaks.
+
+	int layoutWithLineBreaks( int charactersPerLine,
+							  float offset,
+						      float horizonalSpacing,
+							  float verticalSpacing )
+	{
 		float cx = x;
 		float cy = y + offset;
 
 		int characters = 0;
 		int lines = 0;
 
-        if (a>0.0001f && parentAlpha>0.0001f)
-		{
-			glColor4f(r,g,b,a*parentAlpha);
+		std::string word;
 
-			char buffer[1024];
-			strncpy(buffer, text.c_str(), sizeof(buffer));
-			char *token = strtok(buffer, " ");
-			while (token)
-			{
-				const int wordLength = (int) strlen(token) - 1;
+		std::string::size_type start = text.find_first_not_of(' ');
 
-				if (characters+wordLength>charactersPerLine-1)
-				{
-					cx = x;
-					cy += verticalSpacing;
-					characters = 0;
-					lines ++;
-				}
+		while (start!=std::string::npos)
+		{
+			std::string::size_type end = text.find(' ', start);
+
+			if (end==std::string::npos)
+				end = text.size();
 
-				freetype::print(*font, cx, cy, token);
+			word.assign(text, start, end - start);
 
-				cx += horizonalSpacing * (wordLength+2);
-				characters += wordLength + 2;
+			const int wordLength = (int) word.size() - 1;
 
-				token = strtok(0, " ");
+			if (characters+wordLength>charactersPerLine-1)
+			{
+				cx = x;
+				cy += verticalSpacing;
+				characters = 0;
+				lines ++;
 			}
-        }
+
+			freetype::layout(*font, cx, cy, word.c_str(), cache.vertices);
+
+			cx += horizonalSpacing * (wordLength+2);
+			characters += wordLength + 2;
+
+			start = text.find_first_not_of(' ', end);
+		}
 
 		return lines;
-    }
+	}
+
+	/// cached glyph quads and what they were laid out from.
+
+	struct Layout
+	{
+		std::string text;
+		const freetype::font_data *font;
+		float x, y;
+		int charactersPerLine;
+		float offset;
+		float horizontalSpacing;
+		float verticalSpacing;
+		int lines;
+		std::vector<float> vertices;
+
+		Layout()
+		{
+			font = 0;
+		}
 
-private:
+		bool matches(const Text &text, int charactersPerLine, float offset, float horizontalSpacing, float verticalSpacing) const
+		{
+			return font==text.font && x==text.x && y==text.y && 
+				   this->charactersPerLine==charactersPerLine && this->offset==offset && 
+				   this->horizontalSpacing==horizontalSpacing && this->verticalSpacing==verticalSpacing &&
+				   this->text==text.text;
+		}
+
+		void store(const Text &text, int charactersPerLine, float offset, float horizontalSpacing, float verticalSpacing)
+		{
+			this->text = text.text;
+			font = text.font;
+			x = text.x;
+			y = text.y;
+			this->charactersPerLine = charactersPerLine;
+			this->offset = offset;
+			this->horizontalSpacing = horizontalSpacing;
+			this->verticalSpacing = verticalSpacing;
+			lines = 0;
+			vertices.clear();
+		}
+	};
 
     float a;        ///< alpha value used to fade in/out smoothly following visible flag
+
+	Layout cache;   ///< glyph quads laid out for the current text
 };
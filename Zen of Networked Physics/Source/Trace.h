@@ -0,0 +1,192 @@
+/// Trace.
+/// Records timed scopes and instant events in the Chrome trace event format,
+/// which chrome://tracing and the Perfetto UI load directly. Seeing a correction
+/// on a timeline next to the sync event and replay that caused it is far easier
+/// than lining up client.log and server.log by hand.
+/// Events are buffered and written to the file in blocks, so memory use stays
+/// flat however long the trace runs. Nothing is recorded until a file is opened,
+/// and while closed recording an event costs a single check.
+/// Recording is locked only when built with THREADED_SIMULATION.
+
+#ifdef THREADED_SIMULATION
+#include <mutex>
+#endif
+
+class Trace
+{
+public:
+
+    enum { Block = 4096 };              ///< events buffered before they are written to the file.
+
+    Trace()
+    {
+        file = 0;
+        origin = 0;
+        written = 0;
+    }
+
+    ~Trace()
+    {
+        close();
+    }
+
+    /// Start tracing to a file, names for the trace threads are written first.
+    /// @returns false if the file could not be opened.
+
+    bool open(const char filename[])
+    {
+        close();
+
+        file = fopen(filename, "w");
+
+        if (!file)
+            return false;
+
+        origin = nanoseconds();
+        written = 0;
+
+        events.reserve(Block);
+
+        fprintf(file, "{\"traceEvents\":[\n");
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"simulation\"}},\n");
+        fprintf(file, "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"render\"}}");
+
+        return true;
+    }
+
+    /// Write any buffered events and finish the file.
+
+    void close()
+    {
+        if (!file)
+            return;
+
+        flush();
+
+        fprintf(file, "\n]}\n");
+        fclose(file);
+
+        file = 0;
+    }
+
+    /// True if events are being recorded.
+
+    bool enabled() const
+    {
+        return file!=0;
+    }
+
+    /// Number of events written to the file so far.
+
+    unsigned int count() const
+    {
+        return written;
+    }
+
+    /// Record a scope that ran from start to finish on a thread.
+    /// @param name static string naming the scope.
+    /// @param thread 0 for the simulation thread or 1 for the render thread, see Profiler::Thread.
+    /// @param argument optional static string naming a value to show with the scope.
+
+    void complete(const char name[], int thread, unsigned long long start, unsigned long long finish, const char argument[] = 0, double value = 0)
+    {
+        if (!file)
+            return;
+
+        Event event;
+        event.name = name;
+        event.phase = 'X';
+        event.thread = thread;
+        event.start = start;
+        event.duration = finish - start;
+        event.argument = argument;
+        event.value = value;
+
+        add(event);
+    }
+
+    /// Record something that happened now on a thread.
+    /// @param name static string naming the event.
+    /// @param thread 0 for the simulation thread or 1 for the render thread, see Profiler::Thread.
+    /// @param argument optional static string naming a value to show with the event.
+
+    void instant(const char name[], int thread, const char argument[] = 0, double value = 0)
+    {
+        if (!file)
+            return;
+
+        Event event;
+        event.name = name;
+        event.phase = 'i';
+        event.thread = thread;
+        event.start = nanoseconds();
+        event.duration = 0;
+        event.argument = argument;
+        event.value = value;
+
+        add(event);
+    }
+
+private:
+
+    /// A recorded event, names are static strings so they are never copied.
+
+    struct Event
+    {
+        const char *name;
+        char phase;                     ///< 'X' for a complete scope or 'i' for an instant.
+        int thread;
+        unsigned long long start;       ///< nanoseconds.
+        unsigned long long duration;    ///< nanoseconds.
+        const char *argument;           ///< name of the value, null if none.
+        double value;
+    };
+
+    void add(const Event &event)
+    {
+        #ifdef THREADED_SIMULATION
+        std::lock_guard<std::mutex> lock(mutex);
+        #endif
+
+        events.push_back(event);
+
+        if (events.size()>=Block)
+            flush();
+    }
+
+    /// Write buffered events to the file, times are microseconds since the file was opened.
+
+    void flush()
+    {
+        for (unsigned int i=0; i<events.size(); i++)
+        {
+            const Event &event = events[i];
+
+            fprintf(file, ",\n{\"name\":\"%s\",\"ph\":\"%c\",\"pid\":1,\"tid\":%d,\"ts\":%.3f", event.name, event.phase, event.thread + 1, (event.start - origin) / 1000.0);
+
+            if (event.phase=='X')
+                fprintf(file, ",\"dur\":%.3f", event.duration / 1000.0);
+            else
+                fprintf(file, ",\"s\":\"t\"");
+
+            if (event.argument)
+                fprintf(file, ",\"args\":{\"%s\":%g}", event.argument, event.value);
+
+            fprintf(file, "}");
+        }
+
+        written += (unsigned int) events.size();
+
+        events.clear();
+    }
+
+    FILE *file;
+    unsigned long long origin;          ///< clock time the file was opened.
+    unsigned int written;
+
+    std::vector<Event> events;          ///< events not yet written to the file.
+
+    #ifdef THREADED_SIMULATION
+    std::mutex mutex;                   ///< events may be recorded from the simulation and render threads.
+    #endif
+};
@@ -0,0 +1,99 @@
+/// Triple buffer.
+/// Hands the latest value from one writer thread to one reader thread without
+/// locks. The writer fills the back buffer and publishes it by swapping it with
+/// the middle buffer, the reader picks up the newest value by swapping its front
+/// buffer with the middle buffer. Neither side ever waits for the other: a slow
+/// reader simply skips values, and the writer always has a buffer to fill.
+/// The middle buffer is swapped with the platform atomicExchange.
+
+template <typename T> class TripleBuffer
+{
+public:
+
+    /// Triple buffer statistics.
+
+    struct Statistics
+    {
+        unsigned int published;         ///< values published by the writer.
+        unsigned int received;          ///< values picked up by the reader.
+        unsigned int skipped;           ///< values replaced by a newer one before the reader picked them up.
+    };
+
+    TripleBuffer()
+    {
+        front = 0;
+        middle = 1;
+        back = 2;
+
+        memset(&statistics, 0, sizeof(statistics));
+    }
+
+    /// Buffer for the writer to fill.
+    /// Only valid on the writer thread until the next call to publish.
+
+    T& write()
+    {
+        return buffers[back];
+    }
+
+    /// Publish the value written, making it the newest value for the reader.
+
+    void publish()
+    {
+        const int previous = atomicExchange(&middle, back | Fresh);
+
+        if (previous & Fresh)
+            statistics.skipped++;
+
+        back = previous & Index;
+
+        statistics.published++;
+    }
+
+    /// Pick up the newest value published, if any.
+    /// @returns true if a new value was received.
+
+    bool update()
+    {
+        if (!(atomicLoad(&middle) & Fresh))
+            return false;
+
+        front = atomicExchange(&middle, front) & Index;
+
+        statistics.received++;
+
+        return true;
+    }
+
+    /// The newest value received by the reader.
+    /// Only valid on the reader thread until the next call to update.
+
+    const T& read() const
+    {
+        return buffers[front];
+    }
+
+    /// Statistics, the published and skipped counts belong to the writer thread
+    /// and the received count to the reader thread.
+
+    const Statistics& stats() const
+    {
+        return statistics;
+    }
+
+private:
+
+    enum
+    {
+        Index = 3,                      ///< mask for the buffer index.
+        Fresh = 4                       ///< set on the middle buffer when it holds a value the reader has not received.
+    };
+
+    T buffers[3];
+
+    int front;                          ///< buffer owned by the reader.
+    volatile int middle;                ///< buffer shared between writer and reader, plus the fresh bit.
+    int back;                           ///< buffer owned by the writer.
+
+    Statistics statistics;
+};
@@ -1,5 +1,7 @@
 /// View class.
 /// Responsible for managing lights, rendering the scene etc.
+/// The scene is rendered from snapshots published by the simulation at the end
+/// of each tick, so the view may render on a different thread to the simulation.
 
 struct View
 {
@@ -10,6 +12,9 @@ struct View
         client = 0;
         server = 0;
         proxy = 0;
+
+        trailDistance = 25.0f;
+        trailSkipped = 0;
     }
 
     void initialize(Client &client, Server &server, Proxy &proxy)
@@ -53,13 +58,28 @@ struct View
         latency.x = 20.0f;
         latency.y = 50.0f;
 
-        importantMoves.text = "sending important moves";
-		importantMoves.font = &font.status;
-        importantMoves.r = 1.0f;
-        importantMoves.g = 0.7f;
-        importantMoves.b = 0.1f;
-        importantMoves.x = 20.0f;
-        importantMoves.y = 70.0f;
+        redundantInput.text = "sending redundant input";
+		redundantInput.font = &font.status;
+        redundantInput.r = 1.0f;
+        redundantInput.g = 0.7f;
+        redundantInput.b = 0.1f;
+        redundantInput.x = 20.0f;
+        redundantInput.y = 70.0f;
+
+        profileHeader.text = "profile ms               p50     p99     max  calls";
+        profileHeader.font = &font.status;
+        profileHeader.r = 0.6f;
+        profileHeader.g = 0.8f;
+        profileHeader.b = 1.0f;
+        profileHeader.x = 20.0f;
+        profileHeader.y = 460.0f;
+
+        for (int i=0; i<Profiler::SectionCount; i++)
+        {
+            profile[i].font = &font.status;
+            profile[i].x = 20.0f;
+            profile[i].y = 480.0f + i * 20.0f;
+        }
 
         // initialize panel
 
@@ -73,18 +93,92 @@ struct View
         renderHistory = false;
         renderSmoothedClient = false;
         renderSmoothedProxy = false;
+        renderProfile = false;
+
+        // publish initial snapshot
+
+        publish(0);
+        receive();
+    }
+
+    /// Capture the scenes at the end of tick t and publish them for rendering.
+    /// Called on the simulation thread.
+
+    void publish(unsigned int t)
+    {
+        Snapshot &snapshot = snapshots.write();
+
+        snapshot.time = t;
+        snapshot.clock = (long long) nanoseconds();
+
+        snapshot.client.capture(client->cube);
+        snapshot.server.capture(server->cube);
+        snapshot.proxy.capture(proxy->cube);
+
+        client->capture(snapshot.smoothedClient);
+        proxy->capture(snapshot.smoothedProxy);
+
+        client->history.capture(snapshot.history);
+
+        profiler.report(Profiler::Simulation, snapshot.profile);
+
+        snapshots.publish();
+    }
+
+    /// Pick up the newest snapshot published by the simulation.
+    /// Called on the render thread.
+    /// @returns true if a new snapshot was received.
+
+    bool receive()
+    {
+        return snapshots.update();
+    }
+
+    /// The snapshot being rendered.
+
+    const Snapshot& snapshot() const
+    {
+        return snapshots.read();
     }
 
+    /// Snapshot handoff statistics.
+
+    const TripleBuffer<Snapshot>::Statistics& stats() const
+    {
+        return snapshots.stats();
+    }
+
+    /// Cube rendering and culling statistics for the last frame.
+
+    const CubeRenderer::Statistics& cubeStats() const
+    {
+        return renderer.stats();
+    }
+
+    /// Update text and panel fades by one tick.
+
     void update(unsigned int t)
     {
         packetLoss.update(t);
         latency.update(t);
-        importantMoves.update(t);
+        redundantInput.update(t);
         panel.update(t);
+
+        updateProfile(t);
     }
 
+    /// Render the snapshot received last.
+
     void render(float alpha = 1.0f)
     {
+        Profiler::Timer timer(profiler, Profiler::ViewRender);
+
+        const Snapshot &snapshot = snapshots.read();
+
+        // cull against the view frustum
+
+        frustum.calculate();
+
         // clear color, depth and stencil buffers
 
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
@@ -104,23 +198,29 @@ struct View
 
 		// render various scene elements
 
+        trailSkipped = 0;
+
 		if (renderHistory)
-			client->history.render();
+			trailSkipped = History::render(snapshot.history, snapshot.client.current.size, trail, frustum, trailDistance);
+
+        renderer.begin(frustum);
 
 		if (renderSmoothedProxy)
-			proxy->smoothed.render(light, alpha);
+			snapshot.smoothedProxy.render(renderer, alpha);
 
 		if (renderSmoothedClient)
-			client->smoothed.render(light, alpha);
+			snapshot.smoothedClient.render(renderer, alpha);
 
 		if (renderClient)
-			client->cube.render(light, alpha);
+			snapshot.client.render(renderer, alpha);
 
 		if (renderServer)
-			server->cube.render(light, alpha);
+			snapshot.server.render(renderer, alpha);
 
 		if (renderProxy)
-			proxy->cube.render(light, alpha);
+			snapshot.proxy.render(renderer, alpha);
+
+        renderer.render(light);
 
 		// render shadow overlay quad
 
@@ -161,7 +261,14 @@ struct View
 
 		packetLoss.render();
 		latency.render();
-		importantMoves.render();
+		redundantInput.render();
+
+        // render profile
+
+        profileHeader.render();
+
+        for (int i=0; i<Profiler::SectionCount; i++)
+            profile[i].render();
 
         // render panel
 
@@ -182,12 +289,19 @@ struct View
     bool renderHistory;
     bool renderSmoothedClient;
     bool renderSmoothedProxy;
+    bool renderProfile;
+
+    float trailDistance;            ///< history moves further than this from the eye are not drawn
+    int trailSkipped;               ///< history moves skipped in the last frame, out of view or too far away
 
     // text objects
 
     Text packetLoss;
     Text latency;
-    Text importantMoves;
+    Text redundantInput;
+
+    Text profileHeader;
+    Text profile[Profiler::SectionCount];
 
     // panel for presentation
 
@@ -195,9 +309,49 @@ struct View
 
 private:
 
+    /// Fade the profile overlay in or out, and while it is shown fill it in from
+    /// the simulation profile in the snapshot and the render profile.
+
+    void updateProfile(unsigned int t)
+    {
+        profileHeader.visible = renderProfile;
+        profileHeader.update(t);
+
+        for (int i=0; i<Profiler::SectionCount; i++)
+        {
+            profile[i].visible = renderProfile;
+            profile[i].update(t);
+        }
+
+        if (profileHeader.alpha()==0.0f)
+            return;
+
+        Profiler::Report report = snapshot().profile;
+
+        profiler.report(Profiler::Render, report);
+
+        for (int i=0; i<Profiler::SectionCount; i++)
+        {
+            const Profiler::Statistics &statistics = report.sections[i];
+
+            char buffer[256];
+            sprintf(buffer, "%-20s %7.3f %7.3f %7.3f %6.1f", Profiler::name((Profiler::Section)i), statistics.p50, statistics.p99, statistics.maximum, statistics.calls);
+
+            profile[i].text = buffer;
+        }
+    }
+
     Client *client;
     Server *server;
     Proxy *proxy;
 
     Vector light;                   ///< the light vector for the scene (just one light for now)
+
+    Frustum frustum;                ///< view frustum for culling, recalculated each frame
+
+    CubeRenderer renderer;          ///< draws all cubes in the scene together
+
+    TripleBuffer<Snapshot> snapshots;   ///< scenes published by the simulation for rendering
+
+    std::vector<float> trail;       ///< history trail vertices, kept between frames
 };
@@ -52,6 +52,7 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case VK_F7:       onKeyDown(F7);       break;
                 case VK_F8:       onKeyDown(F8);       break;
                 case VK_F9:       onKeyDown(F9);       break;
+                case VK_F10:      onKeyDown(F10);      break;
             }
             break;
 
@@ -77,9 +78,25 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
                 case VK_F7:       onKeyUp(F7);         break;
                 case VK_F8:       onKeyUp(F8);         break;
                 case VK_F9:       onKeyUp(F9);         break;
+                case VK_F10:      onKeyUp(F10);        break;
             }
             break;
 
+        // F10 activates the menu bar so it arrives as a system key,
+        // other system keys such as Alt+F4 keep their default handling
+
+        case WM_SYSKEYDOWN:
+            if ((wParam&0xFF)!=VK_F10)
+                return DefWindowProc(hWnd, uMsg, wParam, lParam);
+            onKeyDown(F10);
+            break;
+
+        case WM_SYSKEYUP:
+            if ((wParam&0xFF)!=VK_F10)
+                return DefWindowProc(hWnd, uMsg, wParam, lParam);
+            onKeyUp(F10);
+            break;
+
         case WM_CLOSE:
             onQuit();
             break;
@@ -277,21 +294,32 @@ void closeDisplay()
     window = 0;
 }
 
-float time()
+unsigned long long nanoseconds()
 {
-    static __int64 start = 0;
-    static __int64 frequency = 0;
+    static unsigned __int64 frequency = 0;
 
-    if (start==0)
-    {
-        QueryPerformanceCounter((LARGE_INTEGER*)&start);
+    if (frequency==0)
         QueryPerformanceFrequency((LARGE_INTEGER*)&frequency);
-        return 0.0f;
-    }
 
-    __int64 counter = 0;
+    unsigned __int64 counter = 0;
     QueryPerformanceCounter((LARGE_INTEGER*)&counter);
-    return (float) ((counter - start) / double(frequency));
+
+    // split into whole seconds and remainder so the conversion cannot overflow
+
+    const unsigned __int64 seconds = counter / frequency;
+    const unsigned __int64 remainder = counter % frequency;
+
+    return seconds * 1000000000 + remainder * 1000000000 / frequency;
+}
+
+int atomicExchange(volatile int *value, int exchange)
+{
+    return InterlockedExchange((volatile LONG*) value, exchange);
+}
+
+int atomicLoad(volatile int *value)
+{
+    return InterlockedCompareExchange((volatile LONG*) value, 0, 0);
 }
 
 void drawText(float x, float y, const char text[], Vector color, float alpha)